@@ -0,0 +1,90 @@
+/****************************************************************************
+  FileName     [ cirAig.cpp ]
+  PackageName  [ cir ]
+  Synopsis     [ Define the flattened AIG store ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2008-present LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#include "cirAig.h"
+#include "cirGate.h"
+
+using namespace std;
+
+/*******************************/
+/*   Global variable and enum  */
+/*******************************/
+
+/**************************************/
+/*   Static varaibles and functions   */
+/**************************************/
+static inline SimWord
+litValue(const SimWord* val, uint32_t lit)
+{
+   return (lit & 1) ? ~val[lit >> 1] : val[lit >> 1];
+}
+
+/**************************************/
+/*   class CirAig member functions    */
+/**************************************/
+// "dfs" is CirMgr::dfsorder, "n" is the number of gate IDs
+void
+CirAig::build(const GateList& dfs, size_t n)
+{
+   clear();
+   _foStart.assign(n+1, 0);
+   for(size_t i=0; i<dfs.size(); ++i)
+   {
+      const CirGate* g = dfs[i];
+      if(g->isAig())
+      {
+         _aigId.push_back(g->getID());
+         _fanin.push_back(g->getfanin(0).getLit());
+         _fanin.push_back(g->getfanin(1).getLit());
+         ++_foStart[g->getfanin(0).getID()];
+         ++_foStart[g->getfanin(1).getID()];
+      }
+      else if(g->getType() == PO_GATE)
+      {
+         _poId.push_back(g->getID());
+         _poFanin.push_back(g->getfanin(0).getLit());
+         ++_foStart[g->getfanin(0).getID()];
+      }
+   }
+
+   // counts -> offsets; _foStart[id] ends up at the start of gate id
+   for(size_t i=0, sum=0; i<=n; ++i)
+   {
+      size_t cnt = _foStart[i];
+      _foStart[i] = sum;
+      sum += cnt;
+   }
+   _foList.resize(_foStart[n]);
+   vector<uint32_t> fill(_foStart.begin(), _foStart.end()-1);
+   for(size_t i=0; i<_aigId.size(); ++i)
+      for(size_t j=0; j<2; ++j)
+      {
+         uint32_t lit = _fanin[2*i+j];
+         _foList[fill[lit >> 1]++] = (_aigId[i] << 1) | (lit & 1);
+      }
+   for(size_t i=0; i<_poId.size(); ++i)
+      _foList[fill[_poFanin[i] >> 1]++] = (_poId[i] << 1) | (_poFanin[i] & 1);
+}
+
+void
+CirAig::clear()
+{
+   _aigId.clear(); _fanin.clear();
+   _poId.clear(); _poFanin.clear();
+   _foStart.clear(); _foList.clear();
+}
+
+void
+CirAig::simulate(SimWord* val) const
+{
+   const uint32_t* in = _fanin.empty() ? 0 : &_fanin[0];
+   for(size_t i=0, n=_aigId.size(); i<n; ++i, in+=2)
+      val[_aigId[i]] = litValue(val, in[0]) & litValue(val, in[1]);
+   for(size_t i=0, n=_poId.size(); i<n; ++i)
+      val[_poId[i]] = litValue(val, _poFanin[i]);
+}
@@ -0,0 +1,81 @@
+/****************************************************************************
+  FileName     [ cirAig.h ]
+  PackageName  [ cir ]
+  Synopsis     [ Define the flattened (structure-of-arrays) AIG store ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2008-present LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#ifndef CIR_AIG_H
+#define CIR_AIG_H
+
+#include <vector>
+#include <stdint.h>
+#include "cirDef.h"
+
+using namespace std;
+
+// Key of the strash table: the two fanin literals of an AND gate,
+// sorted so that (a & b) and (b & a) hash to the same entry
+class faninpin
+{
+public:
+   faninpin(uint32_t in0 = 0, uint32_t in1 = 0)
+   {
+      _fanin[0] = (in0 < in1 ? in0 : in1);
+      _fanin[1] = (in0 < in1 ? in1 : in0);
+   }
+   ~faninpin() {}
+
+   size_t operator() () const
+   {
+      return (size_t(_fanin[0]) << 20) ^ _fanin[1];
+   }
+   bool operator==(const faninpin& refpin) const
+   {
+      return _fanin[0] == refpin._fanin[0] && _fanin[1] == refpin._fanin[1];
+   }
+private:
+   uint32_t _fanin[2];
+};
+
+
+// A packed copy of the DFS list. Gates are still addressed by their IDs,
+// edges are AIGER literals (ID << 1 | inv):
+//   _aigId[i]                  ID of the i-th AND gate in topological order
+//   _fanin[2i], _fanin[2i+1]   its two fanin literals
+//   _poId[i], _poFanin[i]      the same for the POs
+//   _foList[_foStart[id] .. _foStart[id+1]-1]
+//                              fanout literals of gate "id" (CSR)
+// It is rebuilt by CirMgr::DFSsort() whenever the netlist changes.
+class CirAig
+{
+public:
+   CirAig() {}
+   ~CirAig() {}
+
+   void build(const GateList&, size_t);
+   void clear();
+
+   size_t numAigs() const { return _aigId.size(); }
+   size_t numPOs() const { return _poId.size(); }
+   uint32_t aigId(size_t i) const { return _aigId[i]; }
+   uint32_t fanin0(size_t i) const { return _fanin[2*i]; }
+   uint32_t fanin1(size_t i) const { return _fanin[2*i+1]; }
+   uint32_t poId(size_t i) const { return _poId[i]; }
+   uint32_t poFanin(size_t i) const { return _poFanin[i]; }
+   size_t numFanouts(uint32_t id) const
+      { return _foStart[id+1] - _foStart[id]; }
+   uint32_t fanout(uint32_t id, size_t j) const
+      { return _foList[_foStart[id]+j]; }
+
+   // val[] is indexed by gate ID; PI/CONST words must be set by the caller
+   void simulate(SimWord*) const;
+
+private:
+   vector<uint32_t>   _aigId, _fanin;
+   vector<uint32_t>   _poId, _poFanin;
+   vector<uint32_t>   _foStart, _foList;
+};
+
+#endif // CIR_AIG_H
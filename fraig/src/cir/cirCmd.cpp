@@ -17,7 +17,6 @@
 using namespace std;
 
 extern CirMgr* cirMgr;
-extern int effLimit;
 
 bool
 initCirCmd()
@@ -54,7 +53,7 @@ enum CirCmdState
 static CirCmdState curCmd = CIRINIT;
 
 //----------------------------------------------------------------------
-//    CIRRead <(string fileName)> [-Replace]
+//    CIRRead <(string fileName)> [-Replace] [-Strash]
 //----------------------------------------------------------------------
 CmdExecStatus
 CirReadCmd::exec(const string& option)
@@ -66,13 +65,17 @@ CirReadCmd::exec(const string& option)
    if (options.empty())
       return CmdExec::errorOption(CMD_OPT_MISSING, "");
 
-   bool doReplace = false;
+   bool doReplace = false, doStrash = false;
    string fileName;
    for (size_t i = 0, n = options.size(); i < n; ++i) {
       if (myStrNCmp("-Replace", options[i], 2) == 0) {
          if (doReplace) return CmdExec::errorOption(CMD_OPT_EXTRA,options[i]);
          doReplace = true;
       }
+      else if (myStrNCmp("-Strash", options[i], 2) == 0) {
+         if (doStrash) return CmdExec::errorOption(CMD_OPT_EXTRA,options[i]);
+         doStrash = true;
+      }
       else {
          if (fileName.size())
             return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
@@ -93,7 +96,7 @@ CirReadCmd::exec(const string& option)
    }
    cirMgr = new CirMgr;
 
-   if (!cirMgr->readCircuit(fileName)) {
+   if (!cirMgr->readCircuit(fileName, doStrash)) {
       curCmd = CIRINIT;
       delete cirMgr; cirMgr = 0;
       return CMD_EXEC_ERROR;
@@ -107,14 +110,15 @@ CirReadCmd::exec(const string& option)
 void
 CirReadCmd::usage(ostream& os) const
 {
-   os << "Usage: CIRRead <(string fileName)> [-Replace]" << endl;
+   os << "Usage: CIRRead <(string fileName)> [-Replace] [-Strash]" << endl;
 }
 
 void
 CirReadCmd::help() const
 {
    cout << setw(15) << left << "CIRRead: "
-        << "read in a circuit and construct the netlist" << endl;
+        << "read in a circuit (.aag or .aig) and construct the netlist"
+        << endl;
 }
 
 //----------------------------------------------------------------------
@@ -374,7 +378,10 @@ CirStrashCmd::help() const
 }
 
 //----------------------------------------------------------------------
-//    CIRSIMulate <-Random | -File <string patternFile>>
+//    CIRSIMulate <-Random [-Patterns (size_t num)] [-Classes (size_t num)]
+//                         [-Time (size_t seconds)] [-Stall (size_t words)]
+//                         [-Jobs (size_t threads)]
+//                | -File <string patternFile>>
 //                [-Output (string logFile)]
 //----------------------------------------------------------------------
 CmdExecStatus
@@ -390,8 +397,32 @@ CirSimCmd::exec(const string& option)
 
    ifstream patternFile;
    ofstream logFile;
-   bool doRandom = false, doFile = false, doLog = false;
+   SimParam param;
+   bool doRandom = false, doFile = false, doLog = false, doParam = false;
    for (size_t i = 0, n = options.size(); i < n; ++i) {
+      size_t* limit = 0;
+      if (myStrNCmp("-Patterns", options[i], 2) == 0)
+         limit = &param.maxPatterns;
+      else if (myStrNCmp("-Classes", options[i], 2) == 0)
+         limit = &param.maxClasses;
+      else if (myStrNCmp("-Time", options[i], 2) == 0)
+         limit = &param.maxSeconds;
+      else if (myStrNCmp("-Stall", options[i], 2) == 0)
+         limit = &param.maxStall;
+      else if (myStrNCmp("-Jobs", options[i], 2) == 0)
+         limit = &param.threads;
+      if (limit) {
+         int num;
+         if (*limit)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         if (!myStr2Int(options[i], num) || num <= 0)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+         *limit = num;
+         doParam = true;
+         continue;
+      }
       if (myStrNCmp("-Random", options[i], 2) == 0) {
          if (doRandom || doFile)
             return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
@@ -423,14 +454,18 @@ CirSimCmd::exec(const string& option)
 
    if (!doRandom && !doFile)
       return CmdExec::errorOption(CMD_OPT_MISSING, "");
+   if (doParam && !doRandom)
+      return CmdExec::errorOption(CMD_OPT_ILLEGAL, "-File");
 
    assert (curCmd != CIRINIT);
    if (doLog)
       cirMgr->setSimLog(&logFile);
    else cirMgr->setSimLog(0);
 
-   if (doRandom)
+   if (doRandom) {
+      cirMgr->setSimParam(param);
       cirMgr->randomSim();
+   }
    else
       cirMgr->fileSim(patternFile);
    cirMgr->setSimLog(0);
@@ -442,7 +477,11 @@ CirSimCmd::exec(const string& option)
 void
 CirSimCmd::usage(ostream& os) const
 {
-   os << "Usage: CIRSIMulate <-Random | -File <string patternFile>>\n"
+   os << "Usage: CIRSIMulate <-Random [-Patterns (size_t num)]"
+      << " [-Classes (size_t num)]\n"
+      << "                   [-Time (size_t seconds)] [-Stall (size_t words)]\n"
+      << "                   [-Jobs (size_t threads)]\n"
+      << "                   | -File <string patternFile>>\n"
       << "                   [-Output (string logFile)]" << endl;
 }
 
@@ -454,7 +493,7 @@ CirSimCmd::help() const
 }
 
 //----------------------------------------------------------------------
-//    CIRFraig
+//    CIRFraig [-Jobs (size_t threads)]
 //----------------------------------------------------------------------
 CmdExecStatus
 CirFraigCmd::exec(const string& option)
@@ -467,14 +506,27 @@ CirFraigCmd::exec(const string& option)
    vector<string> options;
    CmdExec::lexOptions(option, options);
 
-   if (!options.empty())
-      return CmdExec::errorOption(CMD_OPT_EXTRA, options[0]);
+   size_t threads = 0;
+   for (size_t i = 0, n = options.size(); i < n; ++i) {
+      if (myStrNCmp("-Jobs", options[i], 2) == 0) {
+         int num;
+         if (threads)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         if (!myStr2Int(options[i], num) || num <= 0)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+         threads = num;
+      }
+      else
+         return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+   }
 
    if (curCmd != CIRSIMULATE) {
       cerr << "Error: circuit is not yet simulated!!" << endl;
       return CMD_EXEC_ERROR;
    }
-   cirMgr->fraig();
+   cirMgr->fraig(threads);
    curCmd = CIRFRAIG;
 
    return CMD_EXEC_DONE;
@@ -483,7 +535,7 @@ CirFraigCmd::exec(const string& option)
 void
 CirFraigCmd::usage(ostream& os) const
 {
-   os << "Usage: CIRFraig" << endl;
+   os << "Usage: CIRFraig [-Jobs (size_t threads)]" << endl;
 }
 
 void
@@ -494,7 +546,7 @@ CirFraigCmd::help() const
 }
 
 //----------------------------------------------------------------------
-//    CIRWrite [(int gateId)][-Output (string aagFile)]
+//    CIRWrite [(int gateId)][-Output (string aagFile)] [-Binary]
 //----------------------------------------------------------------------
 CmdExecStatus
 CirWriteCmd::exec(const string& option)
@@ -511,7 +563,7 @@ CirWriteCmd::exec(const string& option)
       cirMgr->writeAag(cout);
       return CMD_EXEC_DONE;
    }
-   bool hasFile = false;
+   bool hasFile = false, binary = false;
    int gateId;
    CirGate *thisGate = NULL;
    ofstream outfile;
@@ -526,6 +578,11 @@ CirWriteCmd::exec(const string& option)
             return CmdExec::errorOption(CMD_OPT_FOPEN_FAIL, options[1]);
          hasFile = true;
       }
+      else if (myStrNCmp("-Binary", options[i], 2) == 0) {
+         if (binary)
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         binary = true;
+      }
       else if (myStr2Int(options[i], gateId) && gateId >= 0) {
          if (thisGate != NULL)
             return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
@@ -542,7 +599,14 @@ CirWriteCmd::exec(const string& option)
       else return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
    }
 
-   if (!thisGate) {
+   if (binary) {
+      if (thisGate)
+         return CmdExec::errorOption(CMD_OPT_ILLEGAL, "-Binary");
+      if (!hasFile)
+         return CmdExec::errorOption(CMD_OPT_MISSING, "-Output");
+      cirMgr->writeAig(outfile);
+   }
+   else if (!thisGate) {
       assert (hasFile);
       cirMgr->writeAag(outfile);
    }
@@ -555,13 +619,14 @@ CirWriteCmd::exec(const string& option)
 void
 CirWriteCmd::usage(ostream& os) const
 {
-   os << "Usage: CIRWrite [(int gateId)][-Output (string aagFile)]" << endl;
+   os << "Usage: CIRWrite [(int gateId)][-Output (string aagFile)] [-Binary]"
+      << endl;
 }
 
 void
 CirWriteCmd::help() const
 {
    cout << setw(15) << left << "CIRWrite: "
-        << "write the netlist to an ASCII AIG file (.aag)\n";
+        << "write the netlist to an ASCII (.aag) or binary (.aig) AIG file\n";
 }
 
@@ -21,6 +21,10 @@ class SatSolver;
 
 typedef vector<CirGate*>           GateList;
 typedef vector<unsigned>           IdList;
+// one simulation word packs SIMWORD_BITS input patterns
+typedef unsigned long long         SimWord;
+
+#define SIMWORD_BITS 64
 
 enum GateType
 {
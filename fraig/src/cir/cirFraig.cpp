@@ -7,6 +7,10 @@
 ****************************************************************************/
 
 #include <cassert>
+#include <climits>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 #include "cirMgr.h"
 #include "cirGate.h"
 #include "sat.h"
@@ -18,42 +22,73 @@ using namespace std;
 // TODO: Please keep "CirMgr::strash()" and "CirMgr::fraig()" for cir cmd.
 //       Feel free to define your own variables or functions
 
-class faninpin
+// Orders gates by their position in the DFS list
+class rankLess
 {
 public:
-  faninpin(CirGate* gate)
+  rankLess(const vector<size_t>& rank) : _rank(rank) {}
+  bool operator() (const CirGate* a, const CirGate* b) const
   {
-    this->_fanin[0] = gate->getfanin(0);
-    this->_fanin[1] = gate->getfanin(1);
-  }
-  ~faninpin() {}
-
-  faninpin& operator=(const faninpin& pin)
-  {
-    this->_fanin[0] = pin._fanin[0];
-    this->_fanin[1] = pin._fanin[1];
-    return *this;
-  }
-  size_t operator() () const
-  {
-    return _fanin[0].getID()+_fanin[1].getID()+(_fanin[0].getID()%256)*(_fanin[1].getID()%256);
-  }
-  bool operator==(const faninpin& refpin) const
-  {
-    return (_fanin[0] == refpin._fanin[0] && _fanin[1] == refpin._fanin[1]) ||
-           (_fanin[0] == refpin._fanin[1] && _fanin[1] == refpin._fanin[0]);
+    return _rank[a->getID()] < _rank[b->getID()];
   }
 private:
-  pin _fanin[2];
+  const vector<size_t>& _rank;
 };
 
 /*******************************/
 /*   Global variable and enum  */
 /*******************************/
+// Conflict budgets of the SAT calls in the first and the second fraig pass.
+// Pairs still undecided after the second pass are left unmerged.
+static const int64 fraigBudget[2] = { 1000, 100000 };
+// Candidate pairs proven on one solver; also the width of the bit masks
+// that record their counter-examples
+#define FRAIG_BATCH_PAIRS SIMWORD_BITS
+// Result of a pair that goes through an undecided pair of its batch; it is
+// retried in the next round
+static const unsigned char FRAIG_SKIPPED = SAT_UNDECIDED + 1;
 
 /**************************************/
 /*   Static varaibles and functions   */
 /**************************************/
+// The candidates of one fraig round and their results. The workers only
+// write the entries of the batches they take.
+struct CirMgr::FraigJob
+{
+  vector< pair<CirGate*, CirGate*> > pairs;   // (group head, member)
+  // the earlier pairs of its batch in the cones of each pair, bit j for j
+  vector<SimWord> depends;
+  vector<unsigned char> result;               // SatResult or FRAIG_SKIPPED
+  // per batch: (PI index, bit j = its value in the model of pair j)
+  vector< vector< pair<unsigned, SimWord> > > cex;
+  vector<unsigned> piIndex;                   // PI gate ID -> index in _PIs
+  int64 budget;
+  atomic<size_t> next;                        // next batch to take
+};
+
+// The solver of one worker thread; the maps are indexed by gate ID and
+// cleared through "loaded" for the next batch
+struct CirMgr::FraigSolver
+{
+  SatSolver solver;
+  vector<Var> satVar;     // 0 if not encoded in this batch
+  GateList mergedTo;      // the head a gate is proven equal to, if any
+  IdList loaded;          // the gates encoded in this batch
+  vector<SimWord> piBits; // see fraigWorker()
+};
+
+// Fold the dependency (d1, m1) of a fanin into (d, m); see CirMgr::fraig()
+static inline void
+addDep(int& d, SimWord& m, int d1, SimWord m1)
+{
+  if(d1 > d)
+  {
+    d = d1;
+    m = m1;
+  }
+  else if(d1 == d)
+    m |= m1;
+}
 
 /*******************************************/
 /*   Public member functions about fraig   */
@@ -68,63 +103,234 @@ CirMgr::strash()
     cerr << "Error: strash operation has been performed!!\n";
     return;
   }
-  HashMap<faninpin, CirGate*>* hash = new HashMap<faninpin, CirGate*>(gates_num[0] + gates_num[3]);
-  for(size_t i=0; i<dfsorder.size(); ++i)
-    if(dfsorder[i]->getTypeStr() == "AIG")
+  HashMap<faninpin, CirGate*>* hash = new HashMap<faninpin, CirGate*>(getHashSize(_aig.numAigs()));
+  // subst[id] is the literal gate "id" has been merged into
+  vector<uint32_t> subst(_gates.size());
+  for(size_t i=0; i<subst.size(); ++i)
+    subst[i] = i << 1;
+  for(size_t i=0; i<_aig.numAigs(); ++i)
+  {
+    uint32_t in0 = _aig.fanin0(i), in1 = _aig.fanin1(i);
+    faninpin key(subst[in0 >> 1] ^ (in0 & 1), subst[in1 >> 1] ^ (in1 & 1));
+    CirGate* gate = _gates[_aig.aigId(i)];
+    CirGate* tmp = gate;
+    if(hash->query(key, tmp))
     {
-      faninpin key(dfsorder[i]);
-      CirGate* tmp = dfsorder[i];
-      if(hash->query(key, tmp))
+      cout << "Strashing: " << tmp->getID() << " merging " << gate->getID() << "...\n";
+      for(size_t j=0; j<gate->_fanin.size(); ++j)
+        gate->_fanin[j].getGate()->removed_fanout(gate->getID());
+      for(size_t j=0; j<gate->_fanout.size(); ++j)
       {
-        cout << "Strashing: " << tmp->getID() << " merging " << dfsorder[i]->getID() << "...\n";
-        for(size_t j=0; j<dfsorder[i]->_fanin.size(); ++j)
-          dfsorder[i]->_fanin[j].getGate()->removed_fanout(dfsorder[i]->getID());
-        for(size_t j=0; j<dfsorder[i]->_fanout.size(); ++j)
-        {
-          dfsorder[i]->_fanout[j].getGate()->replace_fanin(dfsorder[i]->getID(), tmp, dfsorder[i]->_fanout[j].isinv());
-          tmp->add_fanout(dfsorder[i]->_fanout[j]);
-        }
-        unsigned int deletenum = dfsorder[i]->getID();
-        _AIGs.erase(std::find(_AIGs.begin(), _AIGs.end(), deletenum));
-        delete _gates[deletenum];
-        _gates[deletenum] = NULL;
+        gate->_fanout[j].getGate()->replace_fanin(gate->getID(), tmp, gate->_fanout[j].isinv());
+        tmp->add_fanout(gate->_fanout[j]);
       }
-      else
-        hash->insert(key, tmp);
+      unsigned int deletenum = gate->getID();
+      subst[deletenum] = tmp->getID() << 1;
+      deleteGate(deletenum);
     }
+    else
+      hash->insert(key, tmp);
+  }
   delete hash;
   DFSsort();
   strashCalled = true;
 }
 
+// The candidates are the members of the FEC groups, except the heads,
+// which are kept as the topologically first members; each one is proven
+// against its head. A round cuts the candidates into batches of
+// FRAIG_BATCH_PAIRS in DFS order (fanins first), and the worker threads
+// take the batches one at a time. Every batch is proven on a fresh solver
+// that loads only its cones, so its answers don't depend on which thread
+// ran it or on the other batches. The later pairs of a batch see its
+// earlier merges, but a candidate whose cones go through a candidate of an
+// earlier batch, or through an undecided one of its own, is left to the
+// next round, when those are settled and its proof is easy again.
+// The netlist is only read while the workers run; the results are then
+// committed in candidate order: UNSAT pairs are merged, and the PI values
+// of the SAT models are simulated as counter-example patterns,
+// SIMWORD_BITS at a time, to split all the groups they disprove.
+// Disproved members may end up together in a new group, so rounds are
+// repeated until no candidate is left. Pairs that run out of conflicts are
+// skipped and retried with a larger budget in a second pass, so one hard
+// pair can't stall all the easy ones.
 void
-CirMgr::fraig()
+CirMgr::fraig(size_t threads)
 {
   if(FecGrp.size() == 0)
     return;
-  SatSolver solver;
-  solver.initialize();
+  if(threads == 0)
+    threads = thread::hardware_concurrency();
+  if(threads == 0)
+    threads = 1;
 
-  for(size_t i=0; i<=gates_num[0]; ++i)
-    _gates[i]->satID = solver.newVar();
-  for(size_t i=gates_num[0]+1; i<_gates.size(); ++i)
-    _gates[i]->satID = _gates[i]->_fanin[0].getSATID();
+  vector<size_t> rank(_gates.size(), 0);
+  vector<unsigned> order;
+  for(size_t i=0; i<dfsorder.size(); ++i)
+    if(dfsorder[i]->isAig())
+    {
+      rank[dfsorder[i]->getID()] = i+1;
+      order.push_back(dfsorder[i]->getID());
+    }
+  rank[0] = 0;
+  // checkgrp() keeps the relative order, so the groups stay sorted
+  for(size_t i=0; i<FecGrp.size(); ++i)
+    sort(FecGrp[i].begin(), FecGrp[i].end(), rankLess(rank));
 
-  for(size_t i=0; i<_AIGs.size(); ++i)
-    if(!(_gates[_AIGs[i]]->_visit))
+  FraigJob job;
+  job.piIndex.assign(_gates.size(), 0);
+  for(size_t k=0; k<_PIs.size(); ++k)
+    job.piIndex[_PIs[k]] = k;
+  // one per thread, kept over the rounds
+  FraigSolver* solvers = new FraigSolver[threads];
+  vector<SimWord> cex(_PIs.size(), 0);
+  // undecided[id]: the number of passes that gave up on gate "id"
+  vector<unsigned char> undecided(_gates.size(), 0);
+  vector<char> merged(_gates.size(), 0), dirty;
+  IdList dirtyGrp;
+  // dep[id]: the last batch of this round with a candidate in the cone of
+  // gate "id" (-1 if none, DEFERRED if one is left to the next round), and
+  // depMask[id]: those candidates of that batch, bit j for its pair j
+  vector<int> dep(_gates.size(), -1);
+  vector<SimWord> depMask(_gates.size(), 0);
+  const int DEFERRED = INT_MAX;
+  size_t cexNum = 0, undecNum = 0;
+  for(size_t pass=0; pass<2; ++pass)
+  {
+    undecNum = 0;
+    job.budget = fraigBudget[pass];
+    // the groups are only split, so nothing before the first candidate of
+    // a round becomes a candidate again in this pass
+    size_t start = 0;
+    while(true)
     {
-      _gates[_AIGs[i]]->_visit = true;
-      genProofModel(solver, _gates[_AIGs[i]]);
+      job.pairs.clear();
+      job.depends.clear();
+      size_t pos = start, deferred = 0;
+      bool first = true;
+      for(; pos<order.size(); ++pos)
+      {
+        CirGate* g = _gates[order[pos]];
+        if(!g)
+          continue;
+        int& d = dep[g->ID];
+        SimWord& m = depMask[g->ID];
+        for(size_t j=0; j<2; ++j)
+          addDep(d, m, dep[g->_fanin[j].getID()], depMask[g->_fanin[j].getID()]);
+        if(undecided[g->ID] > pass || FecGrp[g->Grp].size() < 2
+              || FecGrp[g->Grp][0] == g)
+          continue;
+        if(first)
+        {
+          start = pos;
+          first = false;
+        }
+        CirGate* rep = FecGrp[g->Grp][0];
+        addDep(d, m, dep[rep->ID], depMask[rep->ID]);
+        int batch = job.pairs.size() / FRAIG_BATCH_PAIRS;
+        if(d != -1 && d != batch)
+        {
+          d = DEFERRED;
+          // once as many wait as were taken, the rest is mostly behind
+          // them; leave it to the next rounds
+          if(++deferred >= job.pairs.size())
+            break;
+          continue;
+        }
+        d = batch;
+        job.depends.push_back(m);
+        m |= SimWord(1) << (job.pairs.size() % FRAIG_BATCH_PAIRS);
+        job.pairs.push_back(make_pair(rep, g));
+      }
+      for(size_t j=start; j<=pos && j<order.size(); ++j)
+      {
+        dep[order[j]] = -1;
+        depMask[order[j]] = 0;
+      }
+      if(job.pairs.empty())
+        break;
+      size_t batches = (job.pairs.size() + FRAIG_BATCH_PAIRS - 1) / FRAIG_BATCH_PAIRS;
+      job.result.assign(job.pairs.size(), SAT_UNDECIDED);
+      job.cex.assign(batches, vector< pair<unsigned, SimWord> >());
+      job.next = 0;
+      if(threads == 1 || batches == 1)
+        fraigWorker(&job, &solvers[0]);
+      else
+      {
+        vector<thread> pool;
+        for(size_t t=0; t<threads && t<batches; ++t)
+          pool.push_back(thread(&CirMgr::fraigWorker, this, &job, &solvers[t]));
+        for(size_t t=0; t<pool.size(); ++t)
+          pool[t].join();
+      }
+
+      // drop the proven members from their groups in one pass per group
+      dirty.resize(FecGrp.size(), 0);
+      for(size_t i=0; i<job.pairs.size(); ++i)
+        if(job.result[i] == SAT_UNSAT)
+        {
+          CirGate* g = job.pairs[i].second;
+          merged[g->ID] = 1;
+          if(!dirty[g->Grp])
+          {
+            dirty[g->Grp] = 1;
+            dirtyGrp.push_back(g->Grp);
+          }
+        }
+      for(size_t i=0; i<dirtyGrp.size(); ++i)
+      {
+        vector<CirGate*>& grp = FecGrp[dirtyGrp[i]];
+        size_t n = 0;
+        for(size_t j=0; j<grp.size(); ++j)
+          if(!merged[grp[j]->ID])
+            grp[n++] = grp[j];
+        grp.resize(n);
+        dirty[dirtyGrp[i]] = 0;
+      }
+      dirtyGrp.clear();
+      for(size_t i=0; i<job.pairs.size(); ++i)
+      {
+        if(job.result[i] == SAT_UNSAT)
+        {
+          FecReplace(job.pairs[i].first, job.pairs[i].second);
+          continue;
+        }
+        if(job.result[i] == FRAIG_SKIPPED)
+          continue;
+        if(job.result[i] == SAT_UNDECIDED)
+        {
+          ++undecided[job.pairs[i].second->ID];
+          ++undecNum;
+          continue;
+        }
+        const vector< pair<unsigned, SimWord> >& model = job.cex[i / FRAIG_BATCH_PAIRS];
+        SimWord bit = SimWord(1) << (i % FRAIG_BATCH_PAIRS);
+        for(size_t k=0; k<model.size(); ++k)
+          if(model[k].second & bit)
+            cex[model[k].first] |= SimWord(1) << cexNum;
+        if(++cexNum == SIMWORD_BITS)
+        {
+          resimCex(cex, cexNum);
+          cexNum = 0;
+        }
+      }
+      if(cexNum)
+      {
+        resimCex(cex, cexNum);
+        cexNum = 0;
+      }
     }
-  resetVisit();
-  bool result;
-  for(size_t i=0; i<_gates.size(); ++i)
-    if(_gates[i] && FecGrp[_gates[i]->Grp].size() > 1)
-      trymerge(solver, _gates[i]);
+    if(undecNum == 0)
+      break;
+  }
+  delete [] solvers;
   size_t count = 0;
   for(size_t i=0; i<FecGrp.size(); ++i)
     if(FecGrp[i].size() > 1)
       ++count;
+  if(undecNum)
+    cout << undecNum << " pair(s) undecided after " << fraigBudget[1]
+         << " conflicts, left unmerged.\n";
   cout << "Updating by UNSAT... Total #FEC Group = " << count << endl;
   strashCalled = simulateCalled = false;
   DFSsort();
@@ -133,31 +339,128 @@ CirMgr::fraig()
 /********************************************/
 /*   Private member functions about fraig   */
 /********************************************/
+// Take batches from "job" until none is left; each batch gets a fresh
+// solver in "solver".
 void
-CirMgr::genProofModel(SatSolver& s, CirGate* tmp)
+CirMgr::fraigWorker(FraigJob* job, FraigSolver* solver) const
 {
-  if(tmp->getTypeStr() == "PI" || tmp->getTypeStr() == "CONST")
-    return;
-  for(size_t i=0; i<tmp->_fanin.size(); ++i)
+  FraigSolver& fs = *solver;
+  if(fs.satVar.empty())
   {
-    CirGate* next = (tmp->_fanin[i]).getGate();
-    if(next && !(next->_visit))
+    fs.satVar.assign(_gates.size(), 0);
+    fs.mergedTo.assign(_gates.size(), 0);
+    fs.piBits.assign(_PIs.size(), 0);
+  }
+  // the PI values of the SAT models of the current batch, bit j for pair j
+  vector<SimWord>& piBits = fs.piBits;
+  size_t batches = job->cex.size();
+  for(size_t b; (b = job->next++) < batches; )
+  {
+    fs.solver.initialize();
+    for(size_t i=0; i<fs.loaded.size(); ++i)
+    {
+      fs.satVar[fs.loaded[i]] = 0;
+      fs.mergedTo[fs.loaded[i]] = 0;
+    }
+    fs.loaded.clear();
+    size_t begin = b * FRAIG_BATCH_PAIRS;
+    size_t end = begin + FRAIG_BATCH_PAIRS;
+    if(end > job->pairs.size())
+      end = job->pairs.size();
+    // the undecided and the skipped pairs of this batch
+    SimWord open = 0;
+    for(size_t i=begin; i<end; ++i)
     {
-        next->_visit = true;
-        genProofModel(s, next);
+      SimWord bit = SimWord(1) << (i - begin);
+      if(job->depends[i] & open)
+      {
+        job->result[i] = FRAIG_SKIPPED;
+        open |= bit;
+        continue;
+      }
+      SatResult res = provePair(fs, job->pairs[i].first,
+                                job->pairs[i].second, job->budget);
+      job->result[i] = res;
+      if(res == SAT_UNDECIDED)
+        open |= bit;
+      if(res != SAT_SAT)
+        continue;
+      // PIs outside the loaded cones don't matter, leave them 0
+      for(size_t k=0; k<fs.loaded.size(); ++k)
+        if(_gates[fs.loaded[k]]->_gateType == PI_GATE
+              && fs.solver.getValue(fs.satVar[fs.loaded[k]]) == 1)
+          piBits[job->piIndex[fs.loaded[k]]] |= bit;
     }
+    for(size_t k=0; k<fs.loaded.size(); ++k)
+      if(_gates[fs.loaded[k]]->_gateType == PI_GATE)
+      {
+        unsigned pi = job->piIndex[fs.loaded[k]];
+        if(piBits[pi])
+          job->cex[b].push_back(make_pair(pi, piBits[pi]));
+        piBits[pi] = 0;
+      }
   }
-  if(tmp->getTypeStr() == "AIG")
-    s.addAigCNF(tmp->satID, tmp->_fanin[0].getSATID(), tmp->_fanin[0].isinv(),
-                tmp->_fanin[1].getSATID(), tmp->_fanin[1].isinv());
+}
 
+// Add the CNF of the fanin cone of "root" that is not encoded yet and
+// return its variable. A fanin proven equal to its group head in this
+// batch is read as the head, as if the pair was already merged.
+// CONST and undefined gates simulate as 0, so they are pinned to 0 in the
+// CNF too. Var 0 is the solver's dummy variable (see
+// SatSolver::initialize()), so 0 in satVar[] means "not encoded".
+Var
+CirMgr::genProofModel(FraigSolver& fs, CirGate* root) const
+{
+  vector<CirGate*> stack(1, root);
+  while(!stack.empty())
+  {
+    CirGate* g = stack.back();
+    if(fs.satVar[g->ID])
+    {
+      stack.pop_back();
+      continue;
+    }
+    if(g->isAig())
+    {
+      CirGate* in[2];
+      bool inv[2];
+      for(size_t j=0; j<2; ++j)
+      {
+        in[j] = g->_fanin[j].getGate();
+        inv[j] = g->_fanin[j].isinv();
+        if(CirGate* rep = fs.mergedTo[in[j]->ID])
+        {
+          inv[j] ^= (_simValue[rep->ID] != _simValue[in[j]->ID]);
+          in[j] = rep;
+        }
+      }
+      if(!fs.satVar[in[0]->ID] || !fs.satVar[in[1]->ID])
+      {
+        if(!fs.satVar[in[0]->ID]) stack.push_back(in[0]);
+        if(!fs.satVar[in[1]->ID]) stack.push_back(in[1]);
+        continue;
+      }
+      fs.satVar[g->ID] = fs.solver.newVar();
+      fs.solver.addAigCNF(fs.satVar[g->ID], fs.satVar[in[0]->ID], inv[0],
+                          fs.satVar[in[1]->ID], inv[1]);
+    }
+    else
+    {
+      fs.satVar[g->ID] = fs.solver.newVar();
+      if(g->_gateType != PI_GATE)
+        fs.solver.assertProperty(fs.satVar[g->ID], false);
+    }
+    fs.loaded.push_back(g->ID);
+    stack.pop_back();
+  }
+  return fs.satVar[root->ID];
 }
 
 void
 CirMgr::FecReplace(CirGate* fir, CirGate* sec)
 {
-  bool inv = (fir->value != sec->value);
-  if(sec->getTypeStr() == "CONST")
+  bool inv = (_simValue[fir->ID] != _simValue[sec->ID]);
+  if(sec->_gateType == CONST_GATE)
   {
     CirGate* tmp = fir;
     fir = sec;
@@ -171,28 +474,45 @@ CirMgr::FecReplace(CirGate* fir, CirGate* sec)
     sec->_fanout[i].getGate()->replace_fanin(sec->getID(), fir, inv != sec->_fanout[i].isinv());
     fir->add_fanout(sec->_fanout[i].getID(), inv != sec->_fanout[i].isinv());
   }
-  unsigned int deletenum = sec->ID;
-  _AIGs.erase(std::find(_AIGs.begin(), _AIGs.end(), deletenum));
-  delete _gates[deletenum];
-  _gates[deletenum] = NULL;
+  deleteGate(sec->getID());
 }
 
+// Check the miter of "rep" and "g" within "budget" conflicts. On SAT the
+// model is left in the solver; on UNSAT the equivalence is asserted and the
+// cones loaded later read "g" as "rep". The miter only lives for this query
+// (under an activation literal), so the batch's later queries neither
+// branch on it nor propagate through it.
+SatResult
+CirMgr::provePair(FraigSolver& fs, CirGate* rep, CirGate* g,
+                  int64 budget) const
+{
+  Var va = genProofModel(fs, rep), vb = genProofModel(fs, g);
+  bool inv = (_simValue[rep->ID] != _simValue[g->ID]);
+  Var act = fs.solver.newVar();
+  fs.solver.addMiterCNF(act, va, false, vb, inv);
+  fs.solver.assumeRelease();
+  fs.solver.assumeProperty(act, true);
+  SatResult res = fs.solver.assumpSolve(budget);
+  fs.solver.retireActivation(act);
+  if(res == SAT_UNSAT)
+  {
+    fs.solver.addEqCNF(va, false, vb, inv);
+    fs.mergedTo[g->ID] = rep;
+  }
+  return res;
+}
+
+// Simulate the first "num" counter-examples in cex[] and refine FecGrp;
+// the unused bits repeat pattern 0. cex[] is cleared for the next batch.
 void
-CirMgr::trymerge(SatSolver& solver, CirGate* g)
+CirMgr::resimCex(vector<SimWord>& cex, size_t num)
 {
-  for(size_t i=0; i<FecGrp[g->Grp].size(); ++i)
-    if(FecGrp[g->Grp][i] != g)
-    {
-      Var newV = solver.newVar();
-      solver.addXorCNF(newV, g->satID, false, FecGrp[g->Grp][i]->satID,
-                       g->value == FecGrp[g->Grp][i]->value);
-      solver.assumeRelease();
-      solver.assumeProperty(newV, true);
-      if(solver.assumpSolve())
-      {
-        FecReplace(g, FecGrp[g->Grp][i]);
-        FecGrp[g->Grp].erase(FecGrp[g->Grp].begin()+i);
-        --i;
-      }
-    }
+  SimWord pad = num < SIMWORD_BITS ? ~SimWord(0) << num : 0;
+  for(size_t i=0; i<_PIs.size(); ++i)
+  {
+    _simValue[_PIs[i]] = (cex[i] & 1) ? cex[i] | pad : cex[i];
+    cex[i] = 0;
+  }
+  simulateWord();
+  checkgrp();
 }
@@ -24,31 +24,14 @@ using namespace std;
 
 extern CirMgr *cirMgr;
 
-static bool isinvert(unsigned int number) {return number/2 != (number+1)/2;}
-static bool isUndef(CirGate* tmp){return tmp->getTypeStr() == "UNDEF";}
+unsigned CirGate::_globalRef = 0;
+unsigned CirGate::_globalDfsRef = 0;
 
-const unsigned int
-pin::getID() const {return connectGate->ID;}
+static bool isUndef(CirGate* tmp){return tmp->getType() == UNDEF_GATE;}
 
 const string
-pin::getTypeStr() const
-{
-  switch(connectGate->_gateType){
-    case UNDEF_GATE:
-      return "UNDEF";
-    case PI_GATE:
-      return "PI";
-    case PO_GATE:
-      return "PO";
-    case AIG_GATE:
-      return "AIG";
-    case CONST_GATE:
-      return "CONST";
-  }
-}
+pin::getTypeStr() const { return getGate()->getTypeStr(); }
 
-const Var
-pin::getSATID() const {return connectGate->satID;}
 /**************************************/
 /*   class CirGate member functions   */
 /**************************************/
@@ -58,18 +41,18 @@ CirGate::reportGate() const
   cout << "==================================================\n= "
        << getTypeStr() << "(" << ID << "), " << lineNo << endl
        << "= FECs: ";
-  if(getTypeStr() == "CONST" || getTypeStr() == "AIG")
+  SimWord value = cirMgr->simValue(ID);
+  if(_gateType == CONST_GATE || _gateType == AIG_GATE)
     for(size_t i=0; i<cirMgr->FecSize(Grp); ++i)
       if(cirMgr->FecGate(Grp, i)->ID != ID)
-        cout << ((cirMgr->FecGate(Grp, i)->value & value) == 0 ? " !":" ")
+        cout << (cirMgr->simValue(cirMgr->FecGate(Grp, i)->ID) != value ? " !":" ")
              << cirMgr->FecGate(Grp, i)->ID;
-  cout << "\n= Value: " << ((value >> 31) & 1) << ((value >> 30) & 1)
-       << ((value >> 29) & 1) << ((value >> 28) & 1);
-  for(size_t i=4; i<32; ++i)
+  cout << "\n= Value: ";
+  for(size_t i=0; i<SIMWORD_BITS; ++i)
   {
-    if(i%4 == 0)
+    if(i%8 == 0 && i != 0)
       cout << "_";
-    cout << ((value >> (31-i)) & 1);
+    cout << ((value >> (SIMWORD_BITS-1-i)) & 1);
   }
   cout << " =\n==================================================\n";
 }
@@ -78,25 +61,22 @@ void
 CirGate::reportFanin(int level) const
 {
    assert (level >= 0);
+   CirGate::setGlobalRef();
    reportFaninhelp(cirMgr->getGate(this->ID), level, 1);
-   cirMgr->resetVisit();
 }
 
 void
 CirGate::reportFanout(int level) const
 {
    assert (level >= 0);
+   CirGate::setGlobalRef();
    reportFanouthelp(cirMgr->getGate(this->ID), level, 1);
-   cirMgr->resetVisit();
 }
 
 void
 CirGate::add_fanin(unsigned int id)
 {
-   pin pinin;
-   pinin.setGate(cirMgr->getGate(id/2));
-   pinin.setinv(isinvert(id));
-   _fanin.push_back(pinin);
+   _fanin.push_back(pin(id));
 }
 
 void
@@ -104,15 +84,13 @@ CirGate::removed_fanin(unsigned int id)
 {
    for(size_t i=0; i<_fanin.size(); ++i)
      if(_fanin[i].getID() == id)
-       _fanin.erase(_fanout.begin()+i);
+       _fanin.erase(_fanin.begin()+i);
 }
 
 void
 CirGate::replace_fanin(unsigned int _id, CirGate* tmp, bool invert)
 {
-  pin pinin;
-  pinin.setGate(tmp);
-  pinin.setinv(invert);
+  pin pinin((tmp->ID << 1) | (invert ? 1 : 0));
   for(size_t i=0; i<_fanin.size(); ++i)
     if(_fanin[i].getID() == _id)
       _fanin[i] = pinin;
@@ -121,10 +99,7 @@ CirGate::replace_fanin(unsigned int _id, CirGate* tmp, bool invert)
 void
 CirGate::add_fanout(unsigned int id, bool invert)
 {
-   pin pinout;
-   pinout.setGate(cirMgr->getGate(id));
-   pinout.setinv(invert);
-   _fanout.push_back(pinout);
+   _fanout.push_back(pin((id << 1) | (invert ? 1 : 0)));
 }
 
 void
@@ -158,7 +133,7 @@ CirAndGate::printGate() const
         << (_fanin[1].isinv()? "!" : "") << _fanin[1].getID() << endl;
 }
 
-CirInGate::CirInGate(unsigned int _id, unsigned int _line):CirGate(PI_GATE, _line){ ID = _id/2; needSweep = false;}
+CirInGate::CirInGate(unsigned int _id, unsigned int _line):CirGate(PI_GATE, _line){ ID = _id/2; }
 
 void
 CirInGate::printGate() const
@@ -173,7 +148,6 @@ CirOutGate::CirOutGate(unsigned int _id, unsigned int _line):CirGate(PO_GATE, _l
 {
    ID = _id;
    _Flt = false;
-   needSweep = false;
 }
 
 void
@@ -196,6 +170,61 @@ CirConstGate::CirConstGate():CirGate(CONST_GATE, 0)
 
 CirUndefGate::CirUndefGate(unsigned int _id):CirGate(UNDEF_GATE, 0) { ID = _id;}
 
+/******************************************/
+/*   class CirGatePool member functions   */
+/******************************************/
+static size_t
+slotSize()
+{
+   size_t sz = sizeof(CirAndGate);
+   if(sizeof(CirInGate) > sz) sz = sizeof(CirInGate);
+   if(sizeof(CirOutGate) > sz) sz = sizeof(CirOutGate);
+   if(sizeof(CirConstGate) > sz) sz = sizeof(CirConstGate);
+   if(sizeof(CirUndefGate) > sz) sz = sizeof(CirUndefGate);
+   return (sz + sizeof(void*) - 1) / sizeof(void*) * sizeof(void*);
+}
+
+static const size_t SLOT_SIZE = slotSize();
+
+void*
+CirGatePool::alloc()
+{
+   if(_free)
+   {
+     void* p = _free;
+     _free = *(void**)p;
+     return p;
+   }
+   if(_left == 0)
+   {
+     _next = new char[BLOCK_SLOTS * SLOT_SIZE];
+     _blocks.push_back(_next);
+     _left = BLOCK_SLOTS;
+   }
+   void* p = _next;
+   _next += SLOT_SIZE;
+   --_left;
+   return p;
+}
+
+void
+CirGatePool::destroy(CirGate* g)
+{
+   g->~CirGate();
+   *(void**)g = _free;
+   _free = g;
+}
+
+void
+CirGatePool::release()
+{
+   for(size_t i=0; i<_blocks.size(); ++i)
+     delete [] _blocks[i];
+   _blocks.clear();
+   _free = _next = 0;
+   _left = 0;
+}
+
 string
 CirGate::getTypeStr() const
 {
@@ -216,10 +245,10 @@ CirGate::getTypeStr() const
 void
 CirGate::reportFaninhelp(CirGate* tmp, int level, int space) const
 {
-   cout << tmp->getTypeStr() << " " << tmp->getID() << (tmp->_visit ? "*\n" : "\n");
-   if(level == 0 || tmp->_visit)
+   cout << tmp->getTypeStr() << " " << tmp->getID() << (tmp->isGlobalRef() ? "*\n" : "\n");
+   if(level == 0 || tmp->isGlobalRef())
      return;
-   tmp->_visit = true;
+   tmp->setToGlobalRef();
 
    for(size_t i=0; i<tmp->_fanin.size(); ++i)
    {
@@ -233,10 +262,10 @@ CirGate::reportFaninhelp(CirGate* tmp, int level, int space) const
 void
 CirGate::reportFanouthelp(CirGate* tmp, int level, int space) const
 {
-   cout << tmp->getTypeStr() << " " << tmp->getID() << (tmp->_visit ? "*\n" : "\n");
-   if(level == 0 || tmp->_visit)
+   cout << tmp->getTypeStr() << " " << tmp->getID() << (tmp->isGlobalRef() ? "*\n" : "\n");
+   if(level == 0 || tmp->isGlobalRef())
      return;
-   tmp->_visit = true;
+   tmp->setToGlobalRef();
 
    for(size_t i=0; i<tmp->_fanout.size(); ++i)
    {
@@ -246,34 +275,3 @@ CirGate::reportFanouthelp(CirGate* tmp, int level, int space) const
      reportFanouthelp(tmp->_fanout[i].getGate(), level-1, space+1);
    }
 }
-
-void
-CirGate::simulate(size_t const num)
-{
-  for(size_t i=0; i<_fanin.size(); ++i)
-    if(!((_fanin[i]).getGate()->_visit))
-    {
-        (_fanin[i]).getGate()->_visit = true;
-        (_fanin[i]).getGate()->simulate(num);
-    }
-  if(getTypeStr() == "AIG")
-  {
-    unsigned int p1, p2;
-    if(_fanin[0].isinv())
-      p1 = 1 - (1 & (_fanin[0].getGate()->value >> (num%32)));
-    else
-      p1 = (1 & (_fanin[0].getGate()->value >> (num%32)));
-    if(_fanin[1].isinv())
-      p2 = 1 - (1 & (_fanin[1].getGate()->value >> (num%32)));
-    else
-      p2 = (1 & (_fanin[1].getGate()->value >> (num%32)));
-    addValue(p1&p2, num);
-  }
-  else if(getTypeStr() == "PO")
-  {
-    if(_fanin[0].isinv())
-      addValue(1 - (_fanin[0].getGate()->value >> (num%32)), num);
-    else
-      addValue((_fanin[0].getGate()->value >> (num%32)), num);
-  }
-}
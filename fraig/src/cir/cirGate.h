@@ -13,6 +13,7 @@
 #include <vector>
 #include <iostream>
 #include <cmath>
+#include <cassert>
 #include "cirDef.h"
 #include "sat.h"
 
@@ -20,43 +21,55 @@ using namespace std;
 
 // TODO: Feel free to define your own classes, variables, or functions.
 
+// An edge to another gate, held as an AIGER literal (ID << 1 | inv).
+// The gate itself is looked up in cirMgr (see the end of cirMgr.h).
 class pin
 {
 
 public:
-   pin() : inv(true), connectGate(NULL) {};
-   pin(bool invert, CirGate* tmp) : inv(invert), connectGate(tmp) {}
+   pin(unsigned lit = 0) : _lit(lit) {}
    ~pin() {}
 
-   pin& operator = (const pin& refpin)
-   {
-     this->inv = refpin.inv;
-     this->connectGate = refpin.connectGate;
-     return *this;
-   }
-
-   bool operator == (const pin& n) const
-   {
-     if(n.inv == this->inv && n.connectGate == this->connectGate)
-       return true;
-     else
-       return false;
-   }
+   bool operator == (const pin& n) const { return _lit == n._lit; }
 
-   bool isinv() const { return inv; }
-   CirGate* getGate() const { return connectGate; }
-   void setinv(bool invert) {inv = invert;}
-   void setGate(CirGate* tmp) {connectGate = tmp;}
-   const unsigned int getID() const;
+   bool isinv() const { return _lit & 1; }
+   CirGate* getGate() const;
+   void setinv(bool invert) { _lit = (_lit & ~1u) | (invert ? 1 : 0); }
+   void setGate(CirGate* tmp);
+   unsigned getID() const { return _lit >> 1; }
+   unsigned getLit() const { return _lit; }
    const string getTypeStr() const;
-   const Var getSATID() const;
 
  private:
-   bool inv;
-   CirGate* connectGate;
+   unsigned _lit;
 
 };
 
+// The fanins of a gate, stored inside it: an AIG has two, a PO one
+class FaninList
+{
+public:
+   FaninList() : _size(0) {}
+
+   size_t size() const { return _size; }
+   bool empty() const { return _size == 0; }
+   pin& operator[](size_t i) { return _pin[i]; }
+   const pin& operator[](size_t i) const { return _pin[i]; }
+   pin* begin() { return _pin; }
+   void push_back(const pin& p) { assert(_size < 2); _pin[_size++] = p; }
+   void erase(pin* pos)
+   {
+      for(pin* p = pos+1; p < _pin+_size; ++p)
+        *(p-1) = *p;
+      --_size;
+   }
+   void clear() { _size = 0; }
+
+private:
+   pin      _pin[2];
+   unsigned _size;
+};
+
 class CirGate;
 //------------------------------------------------------------------------
 //   Define classes
@@ -71,11 +84,9 @@ public:
      _gateType = _type;
      lineNo = _line;
      _Flt = true;
-     _visit = false;
-     needSweep = true;
+     _ref = 0;
+     _dfsRef = 0;
      Grp = 0;
-     value = 0;
-     valueInv = false;
    }
    virtual ~CirGate() {};
 
@@ -85,7 +96,12 @@ public:
    unsigned int getID() const {return ID;}
    pin getfanin(unsigned int i) const {return _fanin[i];}
    pin getfanout(unsigned int i) const {return _fanout[i];}
-   virtual bool isAig() const {};
+   GateType getType() const { return _gateType; }
+   bool isAig() const { return _gateType == AIG_GATE; }
+   bool isGlobalRef() const { return _ref == _globalRef; }
+   void setToGlobalRef() { _ref = _globalRef; }
+   static void setGlobalRef() { ++_globalRef; }
+   bool inDFS() const { return _dfsRef == _globalDfsRef; }
 
    // Printing functions
    virtual void printGate() const {};
@@ -99,33 +115,26 @@ public:
    void removed_fanout(unsigned int);
    void replace_fanin(unsigned int, CirGate*, bool);
    void replace_fanout(unsigned int, CirGate*);
-   void simulate(size_t const);
-   void addValue(unsigned int i, size_t const num)
-   {
-     if(num%32 == 0)
-     {
-       if(valueInv)
-         value = -1;
-       else
-         value = 0;
-     }
-     if(valueInv)
-       value -= (1-i)*(1 << (num%32));
-     else
-       value += i*(1 << (num%32));
-   }
 
 private:
   void reportFaninhelp(CirGate*, int, int) const;
   void reportFanouthelp(CirGate*, int, int) const;
 
 protected:
-   bool _Flt, _visit, needSweep, valueInv;
-   unsigned int lineNo, ID, Grp, value;
+   bool _Flt;
+   unsigned int lineNo, ID, Grp;
+   // a gate is marked in the current traversal iff _ref == _globalRef;
+   // setGlobalRef() starts a new traversal and so unmarks every gate
+   unsigned _ref;
+   static unsigned _globalRef;
+   // the same for membership in the DFS list: CirMgr::DFSsort() bumps
+   // _globalDfsRef and stamps the gates it reaches
+   unsigned _dfsRef;
+   static unsigned _globalDfsRef;
    GateType _gateType;
-   vector<pin> _fanin, _fanout;
+   FaninList _fanin;
+   vector<pin> _fanout;
    string symbol;
-   Var satID;
 };
 
 class CirAndGate: public CirGate
@@ -136,7 +145,6 @@ class CirAndGate: public CirGate
    CirAndGate(unsigned int, unsigned int);
    ~CirAndGate(){ _fanout.clear(); _fanin.clear();}
    void printGate() const;
-   bool isAig() const { return true; }
 
 private:
 };
@@ -149,7 +157,6 @@ public:
    CirInGate(unsigned int, unsigned int);
    ~CirInGate(){ _fanout.clear(); }
    void printGate() const;
-   bool isAig() const { return false; }
 
 private:
 };
@@ -162,7 +169,6 @@ public:
    CirOutGate(unsigned int, unsigned int);
    ~CirOutGate(){_fanin.clear();}
    void printGate() const;
-   bool isAig() const { return false; }
 
 private:
 };
@@ -181,7 +187,6 @@ public:
      if(!symbol.empty())
        cout << this->getTypeStr() << " " << 0 << endl;
    }
-   bool isAig() const { return false; }
 
 private:
   bool print;
@@ -195,9 +200,33 @@ public:
    CirUndefGate(unsigned int);
    ~CirUndefGate(){}
    void printGate() const { cout << this->getTypeStr() << " " << ID << endl; }
-   bool isAig() const { return false; }
 
 private:
 };
 
+// Gate storage of a CirMgr: every gate class fits in one fixed-size slot,
+// slots are carved out of large blocks, a deleted gate's slot goes on a
+// free list for reuse, and all blocks are released at once with the pool.
+// Gates are built with placement new on alloc().
+class CirGatePool
+{
+public:
+   CirGatePool() : _free(0), _next(0), _left(0) {}
+   ~CirGatePool() { release(); }
+
+   void* alloc();
+   void destroy(CirGate*);   // runs the destructor, recycles the slot
+   void release();           // frees the blocks; live gates must be destroyed
+
+private:
+   static const size_t BLOCK_SLOTS = 4096;
+   vector<char*>  _blocks;
+   void          *_free;
+   char          *_next;
+   size_t         _left;
+};
+
+inline void
+pin::setGate(CirGate* tmp) { _lit = (tmp->getID() << 1) | (_lit & 1); }
+
 #endif // CIR_GATE_H
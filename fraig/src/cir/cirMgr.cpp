@@ -14,9 +14,15 @@
 #include <cassert>
 #include <cstring>
 #include <queue>
+#include <new>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "cirMgr.h"
 #include "cirGate.h"
 #include "util.h"
+#include "myHashMap.h"
 #include "cmdParser.h"
 
 using namespace std;
@@ -57,7 +63,8 @@ enum CirParseError {
 /**************************************/
 static unsigned lineNo = 0;  // in printint, lineNo needs to ++
 static unsigned colNo  = 0;  // in printing, colNo needs to ++
-static char buf[1024];
+static const char *bufPos, *bufEnd;   // parse cursor of readCircuit()
+static const char *lineBegin, *numBegin;   // for colNo of a bad literal
 static string errMsg;
 static int errInt;
 static CirGate *errGate;
@@ -149,157 +156,368 @@ parseError(CirParseError err)
    return false;
 }
 
+// Orders PI gates by their position in _PIs
+class piIndexLess
+{
+public:
+  piIndexLess(const vector<unsigned>& index) : _index(index) {}
+  bool operator() (const CirGate* a, const CirGate* b) const
+  {
+    return _index[a->getID()] < _index[b->getID()];
+  }
+private:
+  const vector<unsigned>& _index;
+};
+
+// Read-only mapping of a whole file, released with the object
+class MappedFile
+{
+public:
+   MappedFile(const string& fileName) : _data(0), _size(0)
+   {
+      int fd = open(fileName.c_str(), O_RDONLY);
+      if(fd < 0)
+        return;
+      struct stat st;
+      if(fstat(fd, &st) == 0)
+      {
+        _size = st.st_size;
+        if(_size == 0)
+          _data = "";
+        else
+        {
+          void* p = mmap(0, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+          if(p != MAP_FAILED)
+          {
+            madvise(p, _size, MADV_SEQUENTIAL);
+            _data = (const char*)p;
+          }
+        }
+      }
+      close(fd);
+   }
+   ~MappedFile() { if(_data && _size) munmap((void*)_data, _size); }
+
+   const char* data() const { return _data; }
+   size_t size() const { return _size; }
+
+private:
+   const char* _data;
+   size_t      _size;
+};
+
+// Output buffer of the AIGER writers. Numbers are formatted by hand and
+// the text reaches the stream in BUF_SIZE chunks, not line by line.
+class OutBuf
+{
+public:
+   OutBuf(ostream& os) : _os(os), _n(0) {}
+   ~OutBuf() { flush(); }
+
+   OutBuf& operator<<(char c)
+   {
+      if(_n == BUF_SIZE) flush();
+      _buf[_n++] = c;
+      return *this;
+   }
+   OutBuf& operator<<(const char* str) { return write(str, strlen(str)); }
+   OutBuf& operator<<(const string& str) { return write(str.data(), str.size()); }
+   OutBuf& operator<<(int n) { return *this << (unsigned long)n; }
+   OutBuf& operator<<(unsigned n) { return *this << (unsigned long)n; }
+   OutBuf& operator<<(unsigned long n)
+   {
+      char tmp[24];
+      size_t len = 0;
+      do { tmp[len++] = '0' + n % 10; n /= 10; } while(n);
+      if(_n + len > BUF_SIZE) flush();
+      while(len) _buf[_n++] = tmp[--len];
+      return *this;
+   }
+   // one unsigned of the binary AIGER format: 7 bits per byte, low bits
+   // first, the MSB set on every byte but the last
+   void putDelta(unsigned n)
+   {
+      if(_n + 5 > BUF_SIZE) flush();
+      while(n & ~0x7fu)
+      {
+        _buf[_n++] = char((n & 0x7f) | 0x80);
+        n >>= 7;
+      }
+      _buf[_n++] = char(n);
+   }
+   OutBuf& write(const char* str, size_t len)
+   {
+      if(_n + len > BUF_SIZE)
+      {
+        flush();
+        if(len > BUF_SIZE)
+        {
+          _os.write(str, len);
+          return *this;
+        }
+      }
+      memcpy(_buf + _n, str, len);
+      _n += len;
+      return *this;
+   }
+   void flush() { _os.write(_buf, _n); _n = 0; }
+
+private:
+   static const size_t BUF_SIZE = 1 << 16;
+   ostream&  _os;
+   size_t    _n;
+   char      _buf[BUF_SIZE];
+};
+
+// Scan the unsigned number at bufPos after skipping spaces; on failure
+// errMsg holds "what(offending token)"
+static bool
+scanNum(unsigned& num, const char* what)
+{
+   while(bufPos < bufEnd && *bufPos == ' ') ++bufPos;
+   numBegin = bufPos;
+   num = 0;
+   while(bufPos < bufEnd && isdigit(*bufPos))
+     num = num*10 + (*bufPos++ - '0');
+   if(bufPos != numBegin && (bufPos == bufEnd || *bufPos == ' ' || *bufPos == '\n'))
+     return true;
+   while(bufPos < bufEnd && *bufPos != ' ' && *bufPos != '\n') ++bufPos;
+   errMsg = string(what) + "(" + string(numBegin, bufPos) + ")";
+   return false;
+}
+
+// Report the literal just read by scanNum() as out of range
+static bool
+litTooBig(unsigned lit)
+{
+   errInt = lit;
+   colNo = numBegin - lineBegin;
+   return parseError(MAX_LIT_ID);
+}
+
+// Decode one unsigned of the binary AIGER format: 7 bits per byte, low
+// bits first, the MSB set on every byte but the last
+static bool
+scanDelta(unsigned& num)
+{
+   num = 0;
+   for(unsigned shift = 0; bufPos < bufEnd && shift < 32; shift += 7)
+   {
+     unsigned char ch = *bufPos++;
+     num |= unsigned(ch & 0x7f) << shift;
+     if(!(ch & 0x80))
+       return true;
+   }
+   return false;
+}
+
+// Move bufPos to the start of the next line
+static void
+nextLine()
+{
+   const char* eol = (const char*)memchr(bufPos, '\n', bufEnd - bufPos);
+   bufPos = eol ? eol + 1 : bufEnd;
+}
+
 /**************************************************************/
 /*   class CirMgr member functions for circuit construction   */
 /**************************************************************/
+// The file is mapped and scanned once: the numbers are stored as they are
+// read and the gates are connected afterwards from those arrays. Both the
+// ASCII ("aag") and the binary ("aig") AIGER headers are accepted.
+// With "strash" set, the AND gates are built through a unique table
+// (see buildStrashed()) instead of one gate per AAG line
 bool
-CirMgr::readCircuit(const string& fileName)
+CirMgr::readCircuit(const string& fileName, bool strash)
 {
-   unsigned int pin[3] = {0};
-   ifstream cir_file(fileName, ifstream::in);
-   if(cir_file.fail())
+   unsigned int num;
+   vector<unsigned> poLit, andLit, andLine, subst;
+   MappedFile cir_file(fileName);
+   if(!cir_file.data())
    {
      cerr << "File: " << fileName << " can not be opened!\n";
      return false;
    }
+   bufPos = cir_file.data();
+   bufEnd = bufPos + cir_file.size();
+   lineNo = colNo = 0;
 
-   if(!cir_file.getline(buf, 1024, '\n'))
+   if(bufPos == bufEnd)
      return parseError(ILLEGAL_IDENTIFIER);
-
-   colNo = myStrGetTok(buf, errMsg, colNo);
-
+   while(bufPos < bufEnd && *bufPos == ' ') ++bufPos;
+   const char* magic = bufPos;
+   while(bufPos < bufEnd && *bufPos != ' ' && *bufPos != '\n') ++bufPos;
+   bool binary = (string(magic, bufPos) == "aig");
+   static const char* const header[5] =
+     { "number of vars", "number of PIs", "number of latches",
+       "number of POs", "number of AIGs" };
    for(size_t i=0; i<5; ++i)
    {
-     colNo = myStrGetTok(buf, errMsg, colNo);
-     if(!myStr2Int(errMsg, gates_num[i]))
+     if(!scanNum(num, header[i]))
        return parseError(ILLEGAL_NUM);
+     gates_num[i] = num;
    }
-   _gates.resize(gates_num[0]+gates_num[3]+1);
-   colNo = 0;
+   nextLine();
    lineNo++;
-   _gates[0] = new CirConstGate();
+   _gates.resize(gates_num[0]+gates_num[3]+1);
+   _gates[0] = new (_pool.alloc()) CirConstGate();
+   if(binary && gates_num[0] < gates_num[1]+gates_num[2]+gates_num[4])
+   {
+     errMsg = "maximal variable index";
+     errInt = gates_num[0];
+     return parseError(NUM_TOO_SMALL);
+   }
    for(size_t i=0; i<gates_num[1]; ++i)
    {
-     if(!cir_file.getline(buf, 1024, '\n'))
-       return parseError(MISSING_NEWLINE);
-     if(!myStr2Int(buf, errInt))
+     // binary AIGER leaves the inputs implicit: 2, 4, ..., 2I
+     if(binary)
      {
-       errMsg = buf;
-       return parseError(ILLEGAL_NUM);
+       _gates[i+1] = new (_pool.alloc()) CirInGate(2*(i+1), lineNo);
+       _PIs.push_back(i+1);
+       continue;
      }
-
-     _gates[errInt/2] = new CirInGate(errInt, lineNo);
-     _PIs.push_back(errInt/2);
+     if(bufPos == bufEnd)
+       return parseError(MISSING_NEWLINE);
+     lineBegin = bufPos;
+     if(!scanNum(num, "PI literal ID"))
+       return parseError(ILLEGAL_NUM);
+     if(num/2 > unsigned(gates_num[0]))
+       return litTooBig(num);
+     _gates[num/2] = new (_pool.alloc()) CirInGate(num, lineNo);
+     _PIs.push_back(num/2);
+     nextLine();
      lineNo++;
    }
 
-   for(size_t count = gates_num[0]+1; count <= gates_num[0]+gates_num[3]; ++count)
+   poLit.resize(gates_num[3]);
+   for(size_t i=0; i<poLit.size(); ++i)
    {
-     if(!cir_file.getline(buf, 1024, '\n'))
+     if(bufPos == bufEnd)
        return parseError(MISSING_NEWLINE);
-     if(!myStr2Int(buf, errInt))
-     {
-       errMsg = buf;
+     lineBegin = bufPos;
+     if(!scanNum(poLit[i], "PO literal ID"))
        return parseError(ILLEGAL_NUM);
-     }
-     _gates[count] = new CirOutGate(count, lineNo);
-     _POs.push_back(count);
+     if(poLit[i]/2 > unsigned(gates_num[0]))
+       return litTooBig(poLit[i]);
+     _gates[gates_num[0]+1+i] = new (_pool.alloc()) CirOutGate(gates_num[0]+1+i, lineNo);
+     _POs.push_back(gates_num[0]+1+i);
+     nextLine();
      ++lineNo;
    }
-   for(size_t i=0; i<gates_num[4]; ++i)
+
+   andLit.resize(3*gates_num[4]);
+   if(strash)
+     andLine.resize(gates_num[4]);
+   for(size_t i=0; i<andLit.size(); i+=3)
    {
-     if(!cir_file.getline(buf, 1024, '\n'))
+     if(binary)
+     {
+       // lhs is implicit, the fanins are two varint deltas; rhs0 < lhs,
+       // so a zero first delta is malformed
+       unsigned d0, d1;
+       andLit[i] = 2*(gates_num[1]+gates_num[2]+i/3+1);
+       if(!scanDelta(d0) || d0 == 0 || d0 > andLit[i] || !scanDelta(d1)
+          || d1 > andLit[i]-d0)
+       {
+         errMsg = "AND gate encoding";
+         return parseError(ILLEGAL_NUM);
+       }
+       andLit[i+1] = andLit[i]-d0;
+       andLit[i+2] = andLit[i+1]-d1;
+     }
+     else if(bufPos == bufEnd)
        return parseError(MISSING_NEWLINE);
-
+     lineBegin = bufPos;
      for(size_t j=0; j<3; ++j)
      {
-       colNo = myStrGetTok(buf, errMsg, colNo);
-       if(!myStr2Int(errMsg, errInt))
-         return parseError(ILLEGAL_NUM);
-       pin[j] = errInt;
-       if(errInt/2 == 0)
-           _gates[0]->symbol = "print";
+       if(!binary)
+       {
+         const char* what = j ? "AIG input literal ID" : "AIG gate literal ID";
+         if(!scanNum(andLit[i+j], what))
+           return parseError(ILLEGAL_NUM);
+         if(andLit[i+j]/2 > unsigned(gates_num[0]))
+           return litTooBig(andLit[i+j]);
+       }
+       if(andLit[i+j]/2 == 0 && !strash)
+         _gates[0]->symbol = "print";
      }
-     colNo = 0;
-     _gates[pin[0]/2] = new CirAndGate(pin[0], lineNo);
-     _AIGs.push_back(pin[0]/2);
+     if(strash)
+       andLine[i/3] = lineNo;
+     else
+     {
+       _gates[andLit[i]/2] = new (_pool.alloc()) CirAndGate(andLit[i], lineNo);
+       _AIGs.push_back(andLit[i]/2);
+     }
+     if(!binary)
+       nextLine();
      lineNo++;
    }
-   int id;
-   while(cir_file.getline(buf, 1024, '\n'))
+
+   // symbols "i<n> name" / "o<n> name", up to a line holding only "c"
+   while(bufPos < bufEnd)
    {
-     if(myStrNCmp("c", buf, 1) == 0)
+     const char* eol = (const char*)memchr(bufPos, '\n', bufEnd - bufPos);
+     if(!eol)
+       eol = bufEnd;
+     if(eol - bufPos == 1 && tolower(*bufPos) == 'c')
      {
        printCmd = true;
        break;
      }
-     colNo = myStrGetTok(buf, errMsg, colNo);
-     if(errMsg.length()>1)
-       errMsg = errMsg.substr(1);
-     if(myStrNCmp(buf, "i", 1) == 0)
-     {
-       if(!myStr2Int(errMsg, id))
-         return parseError(ILLEGAL_SYMBOL_NAME);
-       errMsg.assign(buf);
-       errMsg.erase(errMsg.begin(), errMsg.begin()+colNo+1);
-       _gates[_PIs[id]]->symbol = errMsg;
-     }
-     else if(myStrNCmp(buf, "o", 1) == 0)
+     char type = tolower(*bufPos);
+     if(type == 'i' || type == 'o')
      {
-       if(!myStr2Int(errMsg, id))
+       ++bufPos;
+       unsigned id = 0;
+       const char* begin = bufPos;
+       while(bufPos < eol && isdigit(*bufPos))
+         id = id*10 + (*bufPos++ - '0');
+       colNo = bufPos - begin + 1;
+       if(bufPos == begin || (bufPos < eol && *bufPos != ' '))
+       {
+         errInt = (bufPos < eol ? *bufPos : 0);
          return parseError(ILLEGAL_SYMBOL_NAME);
-       errMsg.assign(buf);
-       errMsg.erase(errMsg.begin(), errMsg.begin()+colNo+1);
-       _gates[_POs[id]]->symbol = errMsg;
+       }
+       if(id >= (type == 'i' ? _PIs.size() : _POs.size()))
+       {
+         errMsg = (type == 'i' ? "PI index" : "PO index");
+         errInt = id;
+         return parseError(NUM_TOO_BIG);
+       }
+       if(bufPos < eol)
+         ++bufPos;
+       _gates[type == 'i' ? _PIs[id] : _POs[id]]->symbol.assign(bufPos, eol);
      }
+     bufPos = eol + (eol < bufEnd);
      lineNo++;
      colNo = 0;
    }
 
-   cir_file.clear();
-   cir_file.seekg(0, ios::beg);
-   for(size_t i=0; i<=gates_num[1]; ++i)
-     cir_file.getline(buf, 1024, '\n');
+   if(strash)
+     buildStrashed(andLit, andLine, subst);
 
-   for(size_t count = gates_num[0]+1; count <= gates_num[0]+gates_num[3]; ++count)
+   for(size_t i=0; i<poLit.size(); ++i)
    {
-     cir_file.getline(buf, 1024, '\n');
-
-     if(!myStr2Int(buf, errInt))
-     {
-       errMsg = buf;
-       return parseError(ILLEGAL_NUM);
-     }
-     if(_gates[errInt/2])
-       _gates[errInt/2]->_Flt = false;
+     unsigned lit = strash ? subst[poLit[i]/2] ^ (poLit[i] & 1) : poLit[i];
+     if(_gates[lit/2])
+       _gates[lit/2]->_Flt = false;
      else
-     {
-       if(errInt == 0)
-         _gates[0]->symbol = "print";
-       else
-         _gates[errInt/2] = new CirUndefGate(errInt);
-     }
-     _gates[count]->add_fanin(errInt);
-     _gates[errInt/2]->add_fanout(count, isinvert(errInt));
+       _gates[lit/2] = new (_pool.alloc()) CirUndefGate(lit/2);
+     if(lit/2 == 0)
+       _gates[0]->symbol = "print";
+     _gates[_POs[i]]->add_fanin(lit);
+     _gates[lit/2]->add_fanout(_POs[i], isinvert(lit));
    }
 
-   for(size_t i=0; i<_AIGs.size(); ++i)
+   for(size_t i=0; i<andLit.size() && !strash; i+=3)
    {
-     cir_file.getline(buf, 1024, '\n');
-     for(size_t j=0; j<3; ++j)
-     {
-       colNo = myStrGetTok(buf, errMsg, colNo);
-       if(!myStr2Int(errMsg, errInt))
-         return parseError(ILLEGAL_NUM);
-       pin[j] = errInt;
-     }
-     colNo = 0;
+     const unsigned* pin = &andLit[i];
      if(!_gates[pin[1]/2])
-       _gates[pin[1]/2] = new CirUndefGate(pin[1]/2);
+       _gates[pin[1]/2] = new (_pool.alloc()) CirUndefGate(pin[1]/2);
      else
        _gates[pin[1]/2]->_Flt = false;
      if(!_gates[pin[2]/2])
-       _gates[pin[2]/2] = new CirUndefGate(pin[2]/2);
+       _gates[pin[2]/2] = new (_pool.alloc()) CirUndefGate(pin[2]/2);
      else
        _gates[pin[2]/2]->_Flt = false;
      _gates[pin[0]/2]->add_fanin(pin[1]);
@@ -309,10 +527,80 @@ CirMgr::readCircuit(const string& fileName)
    }
 
    DFSsort();
-   strashCalled = false;
+   strashCalled = strash;
    return true;
 }
 
+// "andLit" holds the (output, fanin, fanin) literals of every AAG AND line
+// and "andLine" their line numbers. The gates are built fanins first; x&0,
+// x&!x, x&1 and x&x are folded and an AND whose sorted fanin literals are
+// already in the unique table is reused, so none of them is ever created.
+// subst[id] is the literal that stands for gate "id" afterwards; the
+// undefined gates are created only if a built gate uses them.
+void
+CirMgr::buildStrashed(const vector<unsigned>& andLit,
+                      const vector<unsigned>& andLine, vector<unsigned>& subst)
+{
+   const unsigned undone = ~0u;
+   vector<int> def(gates_num[0]+1, -1);
+   subst.resize(gates_num[0]+1);
+   for(size_t i=0; i<subst.size(); ++i)
+     subst[i] = i << 1;
+   for(size_t i=0; i<andLine.size(); ++i)
+   {
+     def[andLit[3*i]/2] = i;
+     subst[andLit[3*i]/2] = undone;
+   }
+   HashMap<faninpin, unsigned> hash(getHashSize(andLine.size()+1));
+
+   vector<unsigned> stack;
+   for(size_t i=0; i<andLine.size(); ++i)
+   {
+     stack.push_back(andLit[3*i]/2);
+     while(!stack.empty())
+     {
+       unsigned id = stack.back();
+       if(subst[id] != undone)
+       {
+         stack.pop_back();
+         continue;
+       }
+       unsigned in0 = andLit[3*def[id]+1], in1 = andLit[3*def[id]+2];
+       if(subst[in0/2] == undone || subst[in1/2] == undone)
+       {
+         if(subst[in0/2] == undone) stack.push_back(in0/2);
+         if(subst[in1/2] == undone) stack.push_back(in1/2);
+         continue;
+       }
+       stack.pop_back();
+       in0 = subst[in0/2] ^ (in0 & 1);
+       in1 = subst[in1/2] ^ (in1 & 1);
+       if(in0 > in1)
+         swap(in0, in1);
+       if(in0 == 0 || in0 == (in1 ^ 1))
+         subst[id] = 0;
+       else if(in0 == 1 || in0 == in1)
+         subst[id] = in1;
+       else if(!hash.query(faninpin(in0, in1), subst[id]))
+       {
+         if(!_gates[in0/2])
+           _gates[in0/2] = new (_pool.alloc()) CirUndefGate(in0/2);
+         if(!_gates[in1/2])
+           _gates[in1/2] = new (_pool.alloc()) CirUndefGate(in1/2);
+         _gates[id] = new (_pool.alloc()) CirAndGate(id << 1, andLine[def[id]]);
+         _AIGs.push_back(id);
+         _gates[id]->add_fanin(in0);
+         _gates[id]->add_fanin(in1);
+         _gates[in0/2]->add_fanout(id, isinvert(in0));
+         _gates[in1/2]->add_fanout(id, isinvert(in1));
+         _gates[in0/2]->_Flt = _gates[in1/2]->_Flt = false;
+         subst[id] = id << 1;
+         hash.insert(faninpin(in0, in1), subst[id]);
+       }
+     }
+   }
+}
+
 /**********************************************************/
 /*   class CirMgr member functions for circuit printing   */
 /**********************************************************/
@@ -329,15 +617,45 @@ Circuit Statistics
 void
 CirMgr::DFSsort()
 {
-  resetNeepsweep();
+  compactLists();
   dfsorder.clear();
-   for(size_t i=0; i<_POs.size(); ++i)
-     if(!(_gates[_POs[i]]->_visit))
-     {
-       _gates[_POs[i]]->_visit = true;
-       DFS(_gates[_POs[i]]);
-     }
-   resetVisit();
+  GateList roots;
+  for(size_t i=0; i<_POs.size(); ++i)
+    roots.push_back(_gates[_POs[i]]);
+  CirGate::setGlobalRef();
+  dfsCollect(roots, dfsorder);
+  ++CirGate::_globalDfsRef;
+  for(size_t i=0; i<dfsorder.size(); ++i)
+    dfsorder[i]->_dfsRef = CirGate::_globalDfsRef;
+  _aig.build(dfsorder, _gates.size());
+}
+
+// A NULL slot in _gates is the liveness flag; the ID lists are only
+// filtered once per pass over the netlist instead of once per gate
+void
+CirMgr::deleteGate(unsigned id)
+{
+  _pool.destroy(_gates[id]);
+  _gates[id] = NULL;
+  _listDirty = true;
+}
+
+void
+CirMgr::compactLists()
+{
+  if(!_listDirty)
+    return;
+  IdList* lists[2] = { &_PIs, &_AIGs };
+  for(size_t k=0; k<2; ++k)
+  {
+    IdList& l = *lists[k];
+    size_t n = 0;
+    for(size_t i=0; i<l.size(); ++i)
+      if(_gates[l[i]])
+        l[n++] = l[i];
+    l.resize(n);
+  }
+  _listDirty = false;
 }
 
 void
@@ -356,7 +674,7 @@ CirMgr::printNetlist() const
    cout << endl;
    for (unsigned i = 0, n = 0; i < dfsorder.size();++n,  ++i)
    {
-      if(dfsorder[i]->getTypeStr() != "UNDEF")
+      if(dfsorder[i]->_gateType != UNDEF_GATE)
       {
         cout << "[" << n << "] ";
         dfsorder[i]->printGate();
@@ -397,138 +715,157 @@ CirMgr::printFloatGates() const
 void
 CirMgr::printFECPairs() const
 {
-  bool firstinv = false;
   for(size_t i=0, count = 0; i<FecGrp.size(); ++i)
     if(FecGrp[i].size() > 1)
     {
-      if(FecGrp[i][0]->valueInv)
-        firstinv = true;
       cout << "[" << count << "] ";
       for(size_t j=0; j<FecGrp[i].size(); ++j)
-        cout << (firstinv != FecGrp[i][j]->valueInv? "!":"") << FecGrp[i][j]->ID << " ";
+        cout << (_simValue[FecGrp[i][j]->ID] != _simValue[FecGrp[i][0]->ID] ? "!":"")
+             << FecGrp[i][j]->ID << " ";
       cout << endl;
       ++count;
-      firstinv = false;
     }
 }
 
 void
 CirMgr::writeAag(ostream& outfile) const
 {
-   CirGate* tmp;
-   outfile << "aag ";
+   OutBuf out(outfile);
+   out << "aag ";
    for(size_t i=0; i<4; ++i)
-     cout << gates_num[i] << " ";
-   cout << _AIGs.size() << endl;
+     out << gates_num[i] << ' ';
+   out << _AIGs.size() << '\n';
 
    for(size_t i=0; i<_PIs.size(); ++i)
-     outfile << 2*_PIs[i] << endl;
+     out << 2*_PIs[i] << '\n';
    for(size_t i=0; i<_POs.size(); ++i)
-   {
-     unsigned int output = _gates[_POs[i]]->_fanin[0].getID();
-     if(_gates[_POs[i]]->_fanin[0].isinv())
-       outfile << 2*output+1 << endl;
-     else
-       outfile << 2*output << endl;
-   }
+     out << _gates[_POs[i]]->_fanin[0].getLit() << '\n';
    for(size_t i=0; i<_AIGs.size(); ++i)
    {
-     outfile << 2*_AIGs[i] << " ";
-     tmp = _gates[_AIGs[i]];
-     unsigned int input_1 = tmp->_fanin[0].getID();
-     if(tmp->_fanin[0].isinv())
-       outfile << 2*input_1+1 << " ";
-     else
-       outfile << 2*input_1 << " ";
-     unsigned int input_2 = tmp->_fanin[1].getID();
-     if(tmp->_fanin[1].isinv())
-       outfile << 2*input_2+1 << endl;
-     else
-       outfile << 2*input_2 << endl;
+     const CirGate* tmp = _gates[_AIGs[i]];
+     out << 2*_AIGs[i] << ' ' << tmp->_fanin[0].getLit() << ' '
+         << tmp->_fanin[1].getLit() << '\n';
    }
-   cout << "c\nAAG is output by Wei-Jen(Wen) Lee\n";
-}
-
-void
-CirMgr::writeGate(ostream& outfile, CirGate *g) const
-{
-  g->_visit = true;
-  writeDFS(g);
-  size_t in = 0, a = 0;
-  for(size_t j=0; j<_PIs.size(); ++j)
-    if(_gates[_PIs[j]]->_visit)
-      ++in;
-  for(size_t j=0; j<_AIGs.size(); ++j)
-    if(_gates[_AIGs[j]]->_visit)
-      ++a;
-  outfile << "aag " << ((a+in) >= g->ID ? a+in:g->ID) << " " << in << " " << gates_num[2]
-          << " 1 " << a << endl;
-
-  for(size_t i=0; i<_PIs.size(); ++i)
-    if(_gates[_PIs[i]]->_visit)
-      outfile << 2*_PIs[i] << endl;
-  outfile << 2*(g->ID) << endl;
-  CirGate* tmp;
-  for(size_t i=0; i<_AIGs.size(); ++i)
-    if(_gates[_AIGs[i]]->_visit)
-    {
-      outfile << 2*_AIGs[i] << " ";
-      tmp = _gates[_AIGs[i]];
-      unsigned int input_1 = tmp->_fanin[0].getID();
-      if(tmp->_fanin[0].isinv())
-        outfile << 2*input_1+1 << " ";
-      else
-        outfile << 2*input_1 << " ";
-      unsigned int input_2 = tmp->_fanin[1].getID();
-      if(tmp->_fanin[1].isinv())
-        outfile << 2*input_2+1 << endl;
-      else
-        outfile << 2*input_2 << endl;
-      }
-  for(size_t i=0; i<_PIs.size(); ++i)
-    if(_gates[_PIs[i]]->_visit)
-      if(_gates[_PIs[i]]->symbol.length() > 0)
-        outfile << "i" << i << " " << _gates[_PIs[i]]->symbol << endl;
-  outfile << "o0 " << g->ID << endl;
-  if(printCmd)
-    outfile << "c\nWrite gate (" << g->ID << ") by Wei-Jen (Wen) Lee\n";
-  resetVisit();
+   out << "c\nAAG is output by Wei-Jen(Wen) Lee\n";
 }
 
+// Binary AIGER needs the PIs to be 1..I and every AND to follow its
+// fanins, so the AIGs are renumbered in a topological order of their own.
+// UNDEF fanins are written as constant 0, which is how they simulate.
 void
-CirMgr::DFS(CirGate* tmp)
+CirMgr::writeAig(ostream& outfile) const
 {
-   for(size_t i=0; i<tmp->_fanin.size(); ++i)
-   {
-     CirGate* next = (tmp->_fanin[i]).getGate();
-     if(next && !(next->_visit))
+   vector<unsigned> lit(_gates.size(), 0);
+   GateList roots, dfs;
+   IdList order;
+   for(size_t i=0; i<_PIs.size(); ++i)
+     lit[_PIs[i]] = 2*(i+1);
+   for(size_t i=0; i<_AIGs.size(); ++i)
+     roots.push_back(_gates[_AIGs[i]]);
+   CirGate::setGlobalRef();
+   dfsCollect(roots, dfs);
+   for(size_t i=0; i<dfs.size(); ++i)
+     if(dfs[i]->isAig())
      {
-         next->_visit = true;
-         DFS(next);
+       lit[dfs[i]->ID] = 2*(_PIs.size()+order.size()+1);
+       order.push_back(dfs[i]->ID);
      }
+
+   OutBuf out(outfile);
+   out << "aig " << _PIs.size()+order.size() << ' ' << _PIs.size() << " 0 "
+       << _POs.size() << ' ' << order.size() << '\n';
+   for(size_t i=0; i<_POs.size(); ++i)
+   {
+     const pin& p = _gates[_POs[i]]->_fanin[0];
+     out << (lit[p.getID()] | p.isinv()) << '\n';
+   }
+   for(size_t i=0; i<order.size(); ++i)
+   {
+     const CirGate* g = _gates[order[i]];
+     unsigned in0 = lit[g->_fanin[0].getID()] | g->_fanin[0].isinv();
+     unsigned in1 = lit[g->_fanin[1].getID()] | g->_fanin[1].isinv();
+     if(in0 < in1)
+       swap(in0, in1);
+     out.putDelta(lit[order[i]]-in0);
+     out.putDelta(in0-in1);
    }
-   dfsorder.push_back(tmp);
-   tmp->needSweep = false;
+
+   for(size_t i=0; i<_PIs.size(); ++i)
+     if(!_gates[_PIs[i]]->symbol.empty())
+       out << 'i' << i << ' ' << _gates[_PIs[i]]->symbol << '\n';
+   for(size_t i=0; i<_POs.size(); ++i)
+     if(!_gates[_POs[i]]->symbol.empty())
+       out << 'o' << i << ' ' << _gates[_POs[i]]->symbol << '\n';
+   out << "c\nAIG is output by Wei-Jen(Wen) Lee\n";
 }
 
+// Only the cone of "g" is visited; its AIGs come out fanins first
 void
-CirMgr::resetVisit() const
+CirMgr::writeGate(ostream& outfile, CirGate *g) const
 {
-   for(size_t i=0; i<gates_num[0]+gates_num[3]+1; ++i)
-     if(_gates[i])
-       _gates[i]->_visit = false;
+  GateList cone, pis, aigs;
+  CirGate::setGlobalRef();
+  dfsCollect(GateList(1, g), cone);
+  for(size_t i=0; i<cone.size(); ++i)
+    if(cone[i]->isAig())
+      aigs.push_back(cone[i]);
+    else if(cone[i]->_gateType == PI_GATE)
+      pis.push_back(cone[i]);
+  // the inputs and their i<n> symbols follow _PIs, not the DFS
+  vector<unsigned> piIndex(_gates.size(), 0);
+  for(size_t k=0; k<_PIs.size(); ++k)
+    piIndex[_PIs[k]] = k;
+  sort(pis.begin(), pis.end(), piIndexLess(piIndex));
+  unsigned maxId = g->ID;
+  for(size_t i=0; i<cone.size(); ++i)
+    if(cone[i]->ID > maxId) maxId = cone[i]->ID;
+
+  OutBuf out(outfile);
+  out << "aag " << maxId << ' ' << pis.size() << ' ' << gates_num[2]
+      << " 1 " << aigs.size() << '\n';
+  for(size_t i=0; i<pis.size(); ++i)
+    out << 2*pis[i]->ID << '\n';
+  out << 2*g->ID << '\n';
+  for(size_t i=0; i<aigs.size(); ++i)
+    out << 2*aigs[i]->ID << ' ' << aigs[i]->_fanin[0].getLit() << ' '
+        << aigs[i]->_fanin[1].getLit() << '\n';
+  for(size_t i=0; i<pis.size(); ++i)
+    if(pis[i]->symbol.length() > 0)
+      out << 'i' << i << ' ' << pis[i]->symbol << '\n';
+  out << "o0 " << g->ID << '\n';
+  if(printCmd)
+    out << "c\nWrite gate (" << g->ID << ") by Wei-Jen (Wen) Lee\n";
 }
 
+// Append to "order" the gates reachable from "roots" that are not marked
+// in the current traversal, fanins first, and mark them. The caller starts
+// the traversal with CirGate::setGlobalRef(). The explicit stack keeps
+// deep chains (multipliers, long adders) off the call stack.
 void
-CirMgr::writeDFS(CirGate* tmp) const
+CirMgr::dfsCollect(const GateList& roots, GateList& order) const
 {
-  for(size_t i=0; i<tmp->_fanin.size(); ++i)
+  vector< pair<CirGate*, size_t> > stack;   // gate, next fanin to visit
+  for(size_t r=0; r<roots.size(); ++r)
   {
-    CirGate* next = (tmp->_fanin[i]).getGate();
-    if(next && !(next->_visit))
+    if(roots[r]->isGlobalRef())
+      continue;
+    roots[r]->setToGlobalRef();
+    stack.push_back(make_pair(roots[r], 0));
+    while(!stack.empty())
     {
-        next->_visit = true;
-        writeDFS(next);
+      CirGate* g = stack.back().first;
+      if(stack.back().second < g->_fanin.size())
+      {
+        CirGate* next = g->_fanin[stack.back().second++].getGate();
+        if(next && !next->isGlobalRef())
+        {
+          next->setToGlobalRef();
+          stack.push_back(make_pair(next, 0));
+        }
+        continue;
+      }
+      order.push_back(g);
+      stack.pop_back();
     }
   }
 }
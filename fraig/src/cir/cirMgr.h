@@ -20,9 +20,25 @@ using namespace std;
 
 #include "cirDef.h"
 #include "cirGate.h"
+#include "cirAig.h"
 
 extern CirMgr *cirMgr;
 
+// Stop rules of "CIRSIMulate -Random"; a field left at 0 is derived from
+// the circuit size (maxStall) or disables that rule (the others).
+// "threads" only changes the speed, never the result.
+struct SimParam
+{
+   SimParam() : maxPatterns(0), maxClasses(0), maxSeconds(0), maxStall(0),
+                threads(0) {}
+
+   size_t maxPatterns;   // pattern budget
+   size_t maxClasses;    // stop once the candidates form this many classes
+   size_t maxSeconds;    // wall-clock time budget
+   size_t maxStall;      // stop after this many words that split nothing
+   size_t threads;       // simulation threads, 0 for one per hardware thread
+};
+
 class CirMgr
 {
 public:
@@ -31,6 +47,7 @@ public:
       for(size_t i=0; i<5; ++i)
         gates_num[i] = 0;
       simulateCalled = false;
+      _listDirty = false;
    }
    ~CirMgr()
    {
@@ -38,7 +55,7 @@ public:
         return;
       for(size_t i=0; i<gates_num[0]+gates_num[3]+1; ++i)
         if(getGate(i)){
-          delete _gates[i];
+          _gates[i]->~CirGate();
           _gates[i] = NULL;
         }
       _gates.clear();
@@ -59,7 +76,7 @@ public:
 
    // Member functions about circuit construction
    void DFSsort();
-   bool readCircuit(const string&);
+   bool readCircuit(const string&, bool = false);
 
    // Member functions about circuit optimization
    void sweep();
@@ -69,11 +86,13 @@ public:
    void randomSim();
    void fileSim(ifstream&);
    void setSimLog(ofstream *logFile) { _simLog = logFile; }
+   void setSimParam(const SimParam& param) { _simParam = param; }
 
    // Member functions about fraig
    void strash();
    void printFEC() const;
-   void fraig();
+   // "threads" = 0 for one per hardware thread; it never changes the result
+   void fraig(size_t threads = 0);
 
    // Member functions about circuit reporting
    void printSummary() const;
@@ -83,8 +102,8 @@ public:
    void printFloatGates() const;
    void printFECPairs() const;
    void writeAag(ostream&) const;
+   void writeAig(ostream&) const;
    void writeGate(ostream&, CirGate*) const;
-   void resetVisit() const;
    size_t FecSize(size_t i) const
    {
      if(FecGrp.size() > i)
@@ -93,36 +112,53 @@ public:
        return 0;
    }
    CirGate* FecGate(size_t i, size_t j) const {return FecGrp[i][j];}
+   // only the PIs and the DFS list are simulated; the others read as 0
+   SimWord simValue(unsigned gid) const
+   {
+     if(gid >= _simValue.size() || !_gates[gid])
+       return 0;
+     return (_gates[gid]->inDFS() || _gates[gid]->getType() == PI_GATE)
+            ? _simValue[gid] : 0;
+   }
 
 private:
    ofstream           *_simLog;
+   SimParam            _simParam;
    bool printCmd, simulateCalled, strashCalled;
+   // set by deleteGate(): _AIGs/_PIs may still hold IDs whose _gates[]
+   // slot is NULL until compactLists() runs
+   bool _listDirty;
    int gates_num[5];
-   GateList _gates, dfsorder, AIGdfs;
+   CirGatePool _pool;
+   GateList _gates, dfsorder;
    IdList _PIs, _POs, _AIGs;
    vector< vector<CirGate*> > FecGrp;
-   void DFS(CirGate*);
-   void DFSopt(CirGate*);
+   CirAig _aig;
+   vector<SimWord> _simValue;
+   // ~0 for the gates that were 1 in the first simulated pattern; a gate
+   // and its complement are FEC iff their words XOR their phases are equal
+   vector<SimWord> _simPhase;
+   void dfsCollect(const GateList&, GateList&) const;
+   void deleteGate(unsigned);
+   void compactLists();
+   void buildStrashed(const vector<unsigned>&, const vector<unsigned>&,
+                      vector<unsigned>&);
+   void DFSopt();
    void replacegate(CirGate*, CirGate*, bool);
    bool checkgrp();
-   void writeDFS(CirGate*) const;
+   SimWord fecWord(unsigned gid) const { return _simValue[gid] ^ _simPhase[gid]; }
+   void initFecGrp();
+   void simulateWord();
    void FecReplace(CirGate*, CirGate*);
-   void genProofModel(SatSolver&, CirGate*);
-   void trymerge(SatSolver&, CirGate*);
-   void valuereset()
-   {
-     for(size_t i=0; i<_gates.size(); ++i)
-     {
-       if(_gates[i])
-         _gates[i]->value = 0;
-     }
-   }
-   void resetNeepsweep()
-   {
-     for(size_t i=0; i<_gates.size(); ++i)
-       if(_gates[i])
-         _gates[i]->needSweep = true;
-   }
+   struct FraigJob;
+   struct FraigSolver;
+   void fraigWorker(FraigJob*, FraigSolver*) const;
+   Var genProofModel(FraigSolver&, CirGate*) const;
+   SatResult provePair(FraigSolver&, CirGate*, CirGate*, int64) const;
+   void resimCex(vector<SimWord>&, size_t);
 };
 
+inline CirGate*
+pin::getGate() const { return cirMgr->getGate(getID()); }
+
 #endif // CIR_MGR_H
@@ -7,6 +7,7 @@
 ****************************************************************************/
 
 #include <cassert>
+#include <algorithm>
 #include "cirMgr.h"
 #include "cirGate.h"
 #include "util.h"
@@ -23,6 +24,13 @@ using namespace std;
 /**************************************/
 /*   Static varaibles and functions   */
 /**************************************/
+// AIG and UNDEF gates that the last DFSsort() did not reach
+static bool
+isSwept(const CirGate* g)
+{
+   return g && !g->inDFS()
+          && (g->getType() == AIG_GATE || g->getType() == UNDEF_GATE);
+}
 
 /**************************************************/
 /*   Public member functions about optimization   */
@@ -38,18 +46,36 @@ CirMgr::sweep()
      cerr << "Error: circuit has been simulated!! Do \"CIRFraig\" first!!\n";
      return;
    }
-   for(size_t i=gates_num[1]+1; i<=gates_num[0]; ++i)
-     if(_gates[i] && _gates[i]->needSweep)
+   // Only AIG and UNDEF gates go; PIs are part of the interface and stay
+   // even when nothing reads them. Gate IDs are not ordered by type, so
+   // every slot is checked. The fanout lists of the surviving fanins are
+   // filtered once each, and only then are the swept gates freed, so a gate
+   // feeding many swept ones costs its fanout size rather than that times
+   // the number removed
+   IdList swept;
+   vector<bool> touched(_gates.size(), false);
+   for(size_t i=0; i<_gates.size(); ++i)
+     if(isSwept(_gates[i]))
      {
        cout << "Sweeping: " << _gates[i]->getTypeStr() << "(" << _gates[i]->getID()
             << ") removed...\n";
-       if(_gates[i]->isAig())
-         _AIGs.erase(std::find(_AIGs.begin(), _AIGs.end(), _gates[i]->getID()));
+       swept.push_back(i);
        for(size_t j=0; j<_gates[i]->_fanin.size(); ++j)
-         (_gates[i]->_fanin)[j].getGate()->removed_fanout(i);
-       delete _gates[i];
-       _gates[i] = NULL;
+       {
+         CirGate* fin = (_gates[i]->_fanin)[j].getGate();
+         if(isSwept(fin) || touched[fin->getID()])
+           continue;
+         touched[fin->getID()] = true;
+         size_t n = 0;
+         for(size_t k=0; k<fin->_fanout.size(); ++k)
+           if(!isSwept(fin->_fanout[k].getGate()))
+             fin->_fanout[n++] = fin->_fanout[k];
+         fin->_fanout.resize(n);
+       }
      }
+   for(size_t i=0; i<swept.size(); ++i)
+     deleteGate(swept[i]);
+   compactLists();
    strashCalled = false;
 }
 
@@ -64,13 +90,7 @@ CirMgr::optimize()
     cerr << "Error: circuit has been simulated!! Do \"CIRFraig\" first!!\n";
     return;
   }
-  for(size_t i=0; i<_POs.size(); ++i)
-    if(!(_gates[_POs[i]]->_visit))
-    {
-      _gates[_POs[i]]->_visit = true;
-      DFSopt(_gates[_POs[i]]);
-    }
-  resetVisit();
+  DFSopt();
   DFSsort();
   strashCalled = false;
 }
@@ -78,35 +98,31 @@ CirMgr::optimize()
 /***************************************************/
 /*   Private member functions about optimization   */
 /***************************************************/
+// Walk the flattened AIG in topological order; subst[id] is the literal
+// that gate "id" has been replaced with, so later gates see their
+// simplified fanins without going through the pins
 void
-CirMgr::DFSopt(CirGate* tmp)
+CirMgr::DFSopt()
 {
-  for(size_t i=0; i<tmp->_fanin.size(); ++i)
-  {
-    CirGate* next = (tmp->_fanin[i]).getGate();
-    if(next && !(next->_visit))
-    {
-        next->_visit = true;
-        DFSopt(next);
-    }
-  }
-  if(tmp->getTypeStr() == "AIG")
+  vector<uint32_t> subst(_gates.size());
+  for(size_t i=0; i<subst.size(); ++i)
+    subst[i] = i << 1;
+  for(size_t i=0; i<_aig.numAigs(); ++i)
   {
-    if(tmp->_fanin[0].getTypeStr() == "CONST")
-      if(tmp->_fanin[0].isinv())
-        replacegate(tmp, tmp->_fanin[1].getGate(), tmp->_fanin[1].isinv());
-      else
-        replacegate(tmp, _gates[0], 0);
-    else if(tmp->_fanin[1].getTypeStr() == "CONST")
-      if(tmp->_fanin[1].isinv())
-        replacegate(tmp, tmp->_fanin[0].getGate(), tmp->_fanin[0].isinv());
-      else
-        replacegate(tmp, _gates[0], 0);
-    else if(tmp->_fanin[0].getID() == tmp->_fanin[1].getID())
-      if(tmp->_fanin[0].isinv() == tmp->_fanin[1].isinv())
-        replacegate(tmp, tmp->_fanin[0].getGate(), tmp->_fanin[0].isinv());
-      else
-        replacegate(tmp, _gates[0], 0);
+    uint32_t in0 = _aig.fanin0(i), in1 = _aig.fanin1(i);
+    uint32_t a = subst[in0 >> 1] ^ (in0 & 1), b = subst[in1 >> 1] ^ (in1 & 1);
+    uint32_t res;
+    if((a >> 1) == 0)
+      res = (a & 1) ? b : 0;
+    else if((b >> 1) == 0)
+      res = (b & 1) ? a : 0;
+    else if((a >> 1) == (b >> 1))
+      res = (a == b) ? a : 0;
+    else
+      continue;
+    unsigned id = _aig.aigId(i);
+    subst[id] = res;
+    replacegate(_gates[id], _gates[res >> 1], res & 1);
   }
 }
 
@@ -121,8 +137,5 @@ CirMgr::replacegate(CirGate* tmp, CirGate* next, bool inv)
     tmp->_fanout[i].getGate()->replace_fanin(tmp->getID(), next, inv != tmp->_fanout[i].isinv());
     next->add_fanout(tmp->_fanout[i].getID(), inv != tmp->_fanout[i].isinv());
   }
-  unsigned int deletenum = tmp->ID;
-  _AIGs.erase(std::find(_AIGs.begin(), _AIGs.end(), deletenum));
-  delete _gates[deletenum];
-  _gates[deletenum] = NULL;
+  deleteGate(tmp->getID());
 }
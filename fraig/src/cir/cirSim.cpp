@@ -13,10 +13,13 @@
 #include <cassert>
 #include <cstdlib>
 #include <cmath>
+#include <chrono>
+#include <thread>
 #include <sstream>
 #include "cirMgr.h"
 #include "cirGate.h"
 #include "util.h"
+#include "myHashMap.h"
 
 using namespace std;
 
@@ -26,70 +29,136 @@ using namespace std;
 /*******************************/
 /*   Global variable and enum  */
 /*******************************/
+// A thread is only worth its start-up cost on this many AIGs per word
+static const size_t SIM_MIN_AIGS_PER_THREAD = 4096;
+// value arrays of one block: at most this many bytes, words per thread
+static const size_t SIM_SLAB_BYTES = size_t(256) << 20;
+static const size_t SIM_MAX_SLAB_WORDS = 8;
 
 /**************************************/
 /*   Static varaibles and functions   */
 /**************************************/
+// Key of the FEC refinement table: a group index and a simulation word
+// (already XORed with the gate's phase, see CirMgr::fecWord())
+class simKey
+{
+public:
+  simKey(size_t grp = 0, SimWord value = 0) : _grp(grp), _value(value) {}
+  ~simKey() {}
+
+  size_t operator() () const
+  {
+    return size_t(_value ^ (_value >> 32)) ^ (_grp * 0x9e3779b1u);
+  }
+  bool operator==(const simKey& k) const
+  {
+    return _grp == k._grp && _value == k._value;
+  }
+private:
+  size_t   _grp;
+  SimWord  _value;
+};
+
+// gen() only hands out a few random bits per call; stitch a full word
+static SimWord
+randWord(RandomNumGen& gen)
+{
+  SimWord word = 0;
+  for(size_t i=0; i<SIMWORD_BITS; i+=16)
+    word = (word << 16) | SimWord(gen(1 << 16) & 0xffff);
+  return word;
+}
+
+// Worker of randomSim(): simulate "n" words, each in its own value array
+static void
+simSlab(const CirAig* aig, vector<SimWord>* words, size_t n)
+{
+  for(size_t w=0; w<n; ++w)
+    aig->simulate(&words[w][0]);
+}
 
 /************************************************/
 /*   Public member functions about Simulation   */
 /************************************************/
+// Random words are simulated in blocks: each worker thread fills its own
+// slab of value arrays (one array per word) from the shared flattened AIG,
+// then the words are merged into the FEC groups one by one, in the order
+// they were drawn, until a stop rule of _simParam fires. Words simulated
+// past that point are dropped, so the result does not depend on the
+// number of threads. The default rule waits for a run of words that split
+// no FEC group; the run grows with log2(#PI + #AIG), so small circuits
+// stop early and large ones keep going while they still converge.
 void
 CirMgr::randomSim()
 {
-  size_t simNum = 0, simSuccessNum = 0, maxFail = 0;
-  RandomNumGen gen;
-  vector<CirGate*> fec;
-  FecGrp.clear();
-  simulateCalled = true;
-  valuereset();
-  for(size_t i=0; i <= gates_num[0]; ++i)
-    if(_gates[i])
-      if(_gates[i]->getTypeStr() == "CONST" || _gates[i]->getTypeStr() == "AIG")
-        fec.push_back(_gates[i]);
-  FecGrp.push_back(fec);
+  size_t simNum = 0, stall = 0;
+  size_t maxStall = _simParam.maxStall;
+  if(maxStall == 0)
+    maxStall = 2 + size_t(log2(double(_PIs.size() + _aig.numAigs() + 1)));
+  size_t threads = _simParam.threads;
+  if(threads == 0)
+    threads = thread::hardware_concurrency();
+  if(_aig.numAigs() < SIM_MIN_AIGS_PER_THREAD * threads)
+    threads = _aig.numAigs() / SIM_MIN_AIGS_PER_THREAD;
+  if(threads == 0)
+    threads = 1;
+  size_t slab = SIM_SLAB_BYTES / (threads * (_gates.size()+1) * sizeof(SimWord));
+  if(slab > SIM_MAX_SLAB_WORDS) slab = SIM_MAX_SLAB_WORDS;
+  if(slab == 0) slab = 1;
 
-  for(size_t i=0; i<gates_num[1]; ++i)
-  {
-    _gates[_PIs[i]]->addValue(gen(2), simNum);
-    _gates[_PIs[i]]->_visit = true;
-  }
-  if(_gates[0] && _gates[0]->getTypeStr() == "CONST")
-    _gates[0]->_visit = true;
-  for(size_t i=0; i<_POs.size(); ++i)
-  {
-    _gates[_POs[i]]->_visit = true;
-    _gates[_POs[i]]->simulate(simNum);
-  }
-  for(size_t i=gates_num[1]; i<=gates_num[0]; ++i)
-    if(_gates[i] && ((_gates[i]->value & 1) == 1))
-    {
-      _gates[i]->valueInv = true;
-      _gates[i]->value = -1;
-    }
-  simNum++;
-  resetVisit();
-  while(simSuccessNum < 3 && maxFail < 5)
+  RandomNumGen gen;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  double seconds = 0;
+  const char* reason = "no FEC group left to split";
+  initFecGrp();
+  vector< vector<SimWord> > words(threads * slab, _simValue);
+  size_t cand = FecGrp[0].size();   // classes only split, never merge
+  while(cand > 1)
   {
-    for(size_t i=0; i<gates_num[1]; ++i)
+    for(size_t w=0; w<words.size(); ++w)
+      for(size_t i=0; i<_PIs.size(); ++i)
+        words[w][_PIs[i]] = randWord(gen);
+    if(threads == 1)
+      for(size_t w=0; w<words.size(); ++w)
+        _aig.simulate(&words[w][0]);
+    else
     {
-      _gates[_PIs[i]]->addValue(gen(2), simNum);
-      _gates[_PIs[i]]->_visit = true;
+      vector<thread> pool;
+      for(size_t t=0; t<threads; ++t)
+        pool.push_back(thread(simSlab, &_aig, &words[t*slab], slab));
+      for(size_t t=0; t<threads; ++t)
+        pool[t].join();
     }
-    for(size_t i=0; i<_POs.size(); ++i)
+
+    bool stop = false;
+    for(size_t w=0; w<words.size() && !stop; ++w)
     {
-      _gates[_POs[i]]->_visit = true;
-      _gates[_POs[i]]->simulate(simNum);
+      _simValue.swap(words[w]);
+      simNum += SIMWORD_BITS;
+      stall = checkgrp() ? stall+1 : 0;
+      seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+      stop = true;
+      if(stall >= maxStall)
+        reason = "FEC groups converged";
+      else if(_simParam.maxPatterns && simNum >= _simParam.maxPatterns)
+        reason = "pattern budget reached";
+      else if(_simParam.maxClasses && FecGrp.size() >= _simParam.maxClasses)
+        reason = "target FEC class count reached";
+      else if(_simParam.maxSeconds && seconds >= _simParam.maxSeconds)
+        reason = "time budget reached";
+      else
+        stop = (FecGrp.size() == cand);
     }
-    ++simNum;
-    if(checkgrp())
-      ++simSuccessNum;
-    else
-      ++maxFail;
-    resetVisit();
+    if(stop)
+      break;
   }
-  cout << "MAX_FAIL = " << gates_num[4] << endl;
-  cout << simNum << " pattern simulated.\n";
+  cout << "Stop: " << reason << " (" << FecGrp.size() << " classes, "
+       << stall << " idle words)\n";
+  cout << simNum << " pattern simulated";
+  if(seconds > 0)
+    cout << " (" << size_t(simNum / seconds) << " patterns/sec)";
+  cout << ".\n";
   strashCalled = false;
   return;
 }
@@ -99,55 +168,7 @@ CirMgr::fileSim(ifstream& patternFile)
 {
   size_t simNum = 0;
   string data;
-  vector<CirGate*> fec;
-  FecGrp.clear();
-  simulateCalled = true;
-  valuereset();
-  for(size_t i=0; i <= gates_num[0]; ++i)
-    if(_gates[i])
-      if(_gates[i]->getTypeStr() == "CONST" || _gates[i]->getTypeStr() == "AIG")
-        fec.push_back(_gates[i]);
-  FecGrp.push_back(fec);
-  patternFile >> data;
-  if(data.length() != gates_num[1])
-  {
-    cout << "Error: Pattern(" << data << ") length(" << data.length()
-         << ") does not match the number of inputs(" << gates_num[1]
-         << ") in a circuit!!\n0 patterns simulated.\n";
-    return;
-  }
-  for(size_t i=0; i<gates_num[1]; ++i)
-  {
-    if(data[i] != '0' && data[i] != '1')
-    {
-      cerr << "Error: Pattern(" << data << ") contains a non-0/1 character(\'"
-           << data[i] << "\').\n0 patterns simulated.\n";
-      return;
-    }
-    else
-    {
-      if(data[i] == '0')
-        _gates[_PIs[i]]->addValue(0, simNum);
-      else
-        _gates[_PIs[i]]->addValue(1, simNum);
-      _gates[_PIs[i]]->_visit = true;
-    }
-  }
-  if(_gates[0] && _gates[0]->getTypeStr() == "CONST")
-    _gates[0]->_visit = true;
-  for(size_t i=0; i<_POs.size(); ++i)
-  {
-    _gates[_POs[i]]->_visit = true;
-    _gates[_POs[i]]->simulate(simNum%32);
-  }
-  for(size_t i=gates_num[1]; i<=gates_num[0]; ++i)
-    if(_gates[i] && ((_gates[i]->value & 1) == 1))
-    {
-      _gates[i]->valueInv = true;
-      _gates[i]->value = -1;
-    }
-  simNum++;
-  resetVisit();
+  initFecGrp();
   while(patternFile >> data)
   {
     if(data.length() != gates_num[1])
@@ -155,6 +176,7 @@ CirMgr::fileSim(ifstream& patternFile)
       cerr << "Error: Pattern(" << data << ") length(" << data.length()
            << ") does not match the number of inputs(" << gates_num[1]
            << ") in a circuit!!\n0 patterns simulated.\n";
+      FecGrp.clear();
       return;
     }
     for(size_t i=0; i<gates_num[1]; ++i)
@@ -163,25 +185,31 @@ CirMgr::fileSim(ifstream& patternFile)
       {
         cerr << "Error: Pattern(" << data << ") contains a non-0/1 character(\'"
              << data[i] << "\').\n0 patterns simulated.\n";
+        FecGrp.clear();
         return;
       }
-      else
-      {
-        if(data[i] == '0')
-          _gates[_PIs[i]]->addValue(0, simNum);
-        else
-          _gates[_PIs[i]]->addValue(1, simNum);
-        _gates[_PIs[i]]->_visit = true;
-      }
+      else if(data[i] == '1')
+        _simValue[_PIs[i]] |= SimWord(1) << (simNum % SIMWORD_BITS);
     }
-    for(size_t i=0; i<_POs.size(); ++i)
+    ++simNum;
+    if(simNum % SIMWORD_BITS == 0)
     {
-      _gates[_POs[i]]->_visit = true;
-      _gates[_POs[i]]->simulate(simNum);
+      simulateWord();
+      checkgrp();
+      for(size_t i=0; i<_PIs.size(); ++i)
+        _simValue[_PIs[i]] = 0;
     }
-    ++simNum;
+  }
+  if(simNum % SIMWORD_BITS != 0)
+  {
+    // Fill the unused bits with a copy of the first pattern,
+    // so they can never split a FEC group by themselves
+    SimWord pad = ~SimWord(0) << (simNum % SIMWORD_BITS);
+    for(size_t i=0; i<_PIs.size(); ++i)
+      if(_simValue[_PIs[i]] & 1)
+        _simValue[_PIs[i]] |= pad;
+    simulateWord();
     checkgrp();
-    resetVisit();
   }
   cout << simNum << " pattern simulated.\n";
   strashCalled = false;
@@ -191,27 +219,94 @@ CirMgr::fileSim(ifstream& patternFile)
 /*************************************************/
 /*   Private member functions about Simulation   */
 /*************************************************/
+// Split every FEC group by the current simulation words in one sweep:
+// members are bucketed by (group, fecWord()), the bucket of the head
+// stays in place and every other bucket becomes a new group at the end.
+// Groups whose members all agree with the head skip the table.
+// Returns true if no group was split.
 bool
 CirMgr::checkgrp()
 {
-  size_t row = FecGrp.size();
-  vector<CirGate*> newGrp;
+  size_t row = FecGrp.size(), cand = 0;
   for(size_t i=0; i<row; ++i)
+    if(FecGrp[i].size() > 1)
+      cand += FecGrp[i].size();
+  if(cand == 0)
+    return true;
+  if(_simPhase.empty())
   {
-    newGrp.clear();
-    for(size_t j=1; j<FecGrp[i].size(); ++j)
-      if(FecGrp[i][j]->value != FecGrp[i][0]->value && FecGrp[i][j]->value != ~(FecGrp[i][0]->value))
+    _simPhase.resize(_simValue.size());
+    for(size_t i=0; i<_simValue.size(); ++i)
+      _simPhase[i] = (_simValue[i] & 1) ? ~SimWord(0) : 0;
+  }
+
+  HashMap<simKey, size_t> bucket(1);
+  bool tableReady = false;
+  for(size_t i=0; i<row; ++i)
+  {
+    size_t n = FecGrp[i].size(), keep = 1, target;
+    if(n < 2)
+      continue;
+    SimWord head = fecWord(FecGrp[i][0]->ID);
+    while(keep < n && fecWord(FecGrp[i][keep]->ID) == head)
+      ++keep;
+    if(keep == n)
+      continue;
+
+    if(!tableReady)
+    {
+      bucket.init(getHashSize(cand));
+      tableReady = true;
+    }
+    bucket.insert(simKey(i, head), i);
+    for(size_t j=keep; j<n; ++j)
+    {
+      CirGate* g = FecGrp[i][j];
+      simKey key(i, fecWord(g->ID));
+      if(!bucket.query(key, target))
+      {
+        target = FecGrp.size();
+        bucket.insert(key, target);
+        FecGrp.push_back(vector<CirGate*>());
+      }
+      if(target == i)
+        FecGrp[i][keep++] = g;
+      else
       {
-        newGrp.push_back(FecGrp[i][j]);
-        FecGrp[i][j]->Grp = FecGrp.size();
-        FecGrp[i].erase(FecGrp[i].begin()+j);
-        --j;
+        g->Grp = target;
+        FecGrp[target].push_back(g);
       }
-    if(!newGrp.empty())
-      FecGrp.push_back(newGrp);
+    }
+    FecGrp[i].resize(keep);
   }
-  if(row == FecGrp.size())
-    return true;
-  else
-    return false;
+  return row == FecGrp.size();
+}
+
+// Every CONST/AIG gate in the DFS list starts in one big FEC group
+void
+CirMgr::initFecGrp()
+{
+  vector<CirGate*> fec;
+  FecGrp.clear();
+  _simPhase.clear();
+  simulateCalled = true;
+  _simValue.resize(_gates.size(), 0);
+  // fileSim ORs pattern bits into the PI words, so the words left by an
+  // earlier simulation have to go
+  for(size_t i=0; i<_PIs.size(); ++i)
+    _simValue[_PIs[i]] = 0;
+  for(int i=0; i <= gates_num[0]; ++i)
+    if(_gates[i] && (i == 0 || (_gates[i]->isAig() && _gates[i]->inDFS())))
+    {
+      _gates[i]->Grp = 0;
+      fec.push_back(_gates[i]);
+    }
+  FecGrp.push_back(fec);
+}
+
+// One pass over the flattened AIG simulates SIMWORD_BITS patterns
+void
+CirMgr::simulateWord()
+{
+  _aig.simulate(&_simValue[0]);
 }
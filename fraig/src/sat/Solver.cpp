@@ -21,17 +21,37 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #include "Sort.h"
 #include <cmath>
 
-int effLimit = INT_MAX;
-
 //=================================================================================================
 // Helper functions:
 
 
-void removeWatch(vec<Clause*>& ws, Clause* elem)
+// Glucose restarts compare the LBD average of this many last learnt clauses to the overall one.
+static const int lbd_queue_size = 50;
+
+// The clause memory is compacted once freed clauses take this fraction of it.
+static const double garbage_frac = 0.20;
+
+
+// The x-th element (from 0) of the Luby sequence 1,1,2,1,1,2,4,1,1,2,1,1,2,4,8,...
+static double luby(int x)
+{
+    // Find the finite subsequence that contains index 'x', and its size:
+    int size, seq;
+    for (size = 1, seq = 0; size < x+1; seq++, size = 2*size+1);
+    while (size-1 != x){
+        size = (size-1) >> 1;
+        seq--;
+        x = x % size;
+    }
+    return pow(2.0, seq);
+}
+
+
+void removeWatch(vec<Watcher>& ws, CRef elem)
 {
     if (ws.size() == 0) return;     // (skip lists that are already cleared)
     int j = 0;
-    for (; ws[j] != elem  ; j++) assert(j < ws.size());
+    for (; ws[j].cref != elem; j++) assert(j < ws.size());
     for (; j < ws.size()-1; j++) ws[j] = ws[j+1];
     ws.pop();
 }
@@ -106,7 +126,8 @@ void Solver::newClause(const vec<Lit>& ps_, bool learnt, ClauseId id , bool A)
 
     }else{
         // Allocate clause:
-        Clause* c   = Clause_new(learnt, ps, id);
+        CRef    cr  = ca.alloc(ps, learnt, id);
+        Clause& c   = ca[cr];
 
         if (learnt){
             // Put the second watch on the literal with highest decision level:
@@ -116,47 +137,54 @@ void Solver::newClause(const vec<Lit>& ps_, bool learnt, ClauseId id , bool A)
                 if (level[var(ps[i])] > max)
                     max   = level[var(ps[i])],
                     max_i = i;
-            (*c)[1]     = ps[max_i];
-            (*c)[max_i] = ps[1];
+            c[1]     = ps[max_i];
+            c[max_i] = ps[1];
 
             // Bumping:
             claBumpActivity(c); // (newly learnt clauses should be considered active)
 
             // Enqueue asserting literal:
-            check(enqueue((*c)[0], c));
+            check(enqueue(c[0], cr));
 
             // Store clause:
-            watches[index(~(*c)[0])].push(c);
-            watches[index(~(*c)[1])].push(c);
-            learnts.push(c);
-            stats.learnts_literals += c->size();
+            attachClause(cr);
+            learnts.push(cr);
+            stats.learnts_literals += c.size();
 
         }else{
             // Store clause:
-            watches[index(~(*c)[0])].push(c);
-            watches[index(~(*c)[1])].push(c);
-            clauses.push(c);
-            stats.clauses_literals += c->size();
+            attachClause(cr);
+            clauses.push(cr);
+            stats.clauses_literals += c.size();
         }
     }
 }
 
 
+// Puts the two first literals of a clause under watch, each with the other one as blocker.
+//
+void Solver::attachClause(CRef cr)
+{
+    const Clause& c = ca[cr];
+    watchList(cr, 0).push(Watcher(cr, c[1]));
+    watchList(cr, 1).push(Watcher(cr, c[0]));
+}
+
+
 // Disposes a clauses and removes it from watcher lists. NOTE! Low-level; does NOT change the 'clauses' and 'learnts' vector.
 //
-void Solver::remove(Clause* c, bool just_dealloc)
+void Solver::remove(CRef cr)
 {
-    if (!just_dealloc){
-        removeWatch(watches[index(~(*c)[0])], c),
-        removeWatch(watches[index(~(*c)[1])], c);
+    const Clause& c = ca[cr];
+    removeWatch(watchList(cr, 0), cr),
+    removeWatch(watchList(cr, 1), cr);
 
-        if (c->learnt()) stats.learnts_literals -= c->size();
-        else             stats.clauses_literals -= c->size();
+    if (c.learnt()) stats.learnts_literals -= c.size();
+    else            stats.clauses_literals -= c.size();
 
-        if (proof != NULL) proof->deleted(c->id());
-    }
+    if (proof != NULL) proof->deleted(c.id());
 
-    xfree(c);
+    ca.free(cr);
 }
 
 
@@ -164,11 +192,12 @@ void Solver::remove(Clause* c, bool just_dealloc)
 // the clause is binary and satisfied, in which case the first literal is true)
 // Returns True if clause is satisfied (will be removed), False otherwise.
 //
-bool Solver::simplify(Clause* c) const
+bool Solver::simplify(CRef cr) const
 {
+    const Clause& c = ca[cr];
     assert(decisionLevel() == 0);
-    for (int i = 0; i < c->size(); i++){
-        if (value((*c)[i]) == l_True)
+    for (int i = 0; i < c.size(); i++){
+        if (value(c[i]) == l_True)
             return true;
     }
     return false;
@@ -187,13 +216,17 @@ Var Solver::newVar() {
     index = nVars();
     watches     .push();          // (list for positive literal)
     watches     .push();          // (list for negative literal)
-    reason      .push(NULL);
+    bin_watches .push();
+    bin_watches .push();
+    reason      .push(CRef_Undef);
     assigns     .push(toInt(l_Undef));
     level       .push(-1);
     trail_pos   .push(-1);
     activity    .push(0);
     order       .newVar();
     analyze_seen.push(0);
+    polarity    .push(1);
+    lbd_seen    .push(0);
     if (proof != NULL) unit_id.push(ClauseId_NULL);
     return index; }
 
@@ -210,7 +243,8 @@ void Solver::cancelUntil(int level) {
         for (int c = trail.size()-1; c >= trail_lim[level]; c--){
             Var     x  = var(trail[c]);
             assigns[x] = toInt(l_Undef);
-            reason [x] = NULL;
+            reason [x] = CRef_Undef;
+            if (phase_saving) polarity[x] = sign(trail[c]);
             order.undo(x); }
         trail.shrink(trail.size() - trail_lim[level]);
         trail_lim.shrink(trail_lim.size() - level);
@@ -223,7 +257,7 @@ void Solver::cancelUntil(int level) {
 
 /*_________________________________________________________________________________________________
 |
-|  analyze : (confl : Clause*) (out_learnt : vec<Lit>&) (out_btlevel : int&)  ->  [void]
+|  analyze : (confl : CRef) (out_learnt : vec<Lit>&) (out_btlevel : int&)  ->  [void]
 |  
 |  Description:
 |    Analyze conflict and produce a reason clause ('out_learnt') and a backtracking level
@@ -238,13 +272,31 @@ void Solver::cancelUntil(int level) {
 |      * If performing proof-logging, the last derived clause in the proof is the reason clause.
 |________________________________________________________________________________________________@*/
 
+// Literal Block Distance: the number of distinct decision levels among the literals of 'c'. All
+// literals must be assigned. Learnt clauses of low LBD ("glue" clauses) tend to be used again.
+//
+template<class C>
+int Solver::computeLBD(const C& c)
+{
+    int n = 0;
+    lbd_stamp++;
+    for (int i = 0; i < c.size(); i++){
+        int l = level[var(c[i])];
+        if (lbd_seen[l] != lbd_stamp){
+            lbd_seen[l] = lbd_stamp;
+            n++; }
+    }
+    return n;
+}
+
+
 class lastToFirst_lt {  // Helper class to 'analyze' -- order literals from last to first occurance in 'trail[]'.
     const vec<int>& trail_pos;
 public:
     lastToFirst_lt(const vec<int>& t) : trail_pos(t) {}
     bool operator () (Lit p, Lit q) { return trail_pos[var(p)] > trail_pos[var(q)]; }
 };
-void Solver::analyze(Clause* confl, vec<Lit>& out_learnt, int& out_btlevel)
+void Solver::analyze(CRef confl, vec<Lit>& out_learnt, int& out_btlevel)
 {
     vec<char>&     seen  = analyze_seen;
     int            pathC = 0;
@@ -252,16 +304,21 @@ void Solver::analyze(Clause* confl, vec<Lit>& out_learnt, int& out_btlevel)
 
     // Generate conflict clause:
     //
-    if (proof != NULL) proof->beginChain(confl->id());
+    if (proof != NULL) proof->beginChain(ca[confl].id());
     out_learnt.push();          // (leave room for the asserting literal)
     out_btlevel = 0;
     int index = trail.size()-1;
     for(;;){
-        assert(confl != NULL);  // (otherwise should be UIP)
-
-        Clause& c = *confl;
-        if (c.learnt())
-            claBumpActivity(&c);
+        assert(confl != CRef_Undef);    // (otherwise should be UIP)
+
+        Clause& c = ca[confl];
+        if (c.learnt()){
+            claBumpActivity(c);
+            if (c.lbd() > 2){
+                // (the clause takes part in the conflict, its LBD may have improved)
+                uint lbd = computeLBD(c);
+                if (lbd < c.lbd()) c.lbd() = lbd; }
+        }
 
         for (int j = (p == lit_Undef) ? 0 : 1; j < c.size(); j++){
             Lit q = c[j];
@@ -288,7 +345,7 @@ void Solver::analyze(Clause* confl, vec<Lit>& out_learnt, int& out_btlevel)
         pathC--;
         if (pathC == 0) break;
 
-        if (proof != NULL) proof->resolve(confl->id(), ~p);
+        if (proof != NULL) proof->resolve(ca[confl].id(), ~p);
     }
     out_learnt[0] = ~p;
 
@@ -304,18 +361,18 @@ void Solver::analyze(Clause* confl, vec<Lit>& out_learnt, int& out_btlevel)
 
         analyze_toclear.clear();
         for (i = j = 1; i < out_learnt.size(); i++)
-            if (reason[var(out_learnt[i])] == NULL || !analyze_removable(out_learnt[i], min_level))
+            if (reason[var(out_learnt[i])] == CRef_Undef || !analyze_removable(out_learnt[i], min_level))
                 out_learnt[j++] = out_learnt[i];
     }else if(expensive_ccmin == 1){
         // Simplify conflict clause (a little):
         //
         analyze_toclear.clear();
         for (i = j = 1; i < out_learnt.size(); i++){
-            Clause* r = reason[var(out_learnt[i])];
-            if (r == NULL)
+            CRef r = reason[var(out_learnt[i])];
+            if (r == CRef_Undef)
                 out_learnt[j++] = out_learnt[i];
             else{
-                Clause& c = *r;
+                Clause& c = ca[r];
                 for (int k = 1; k < c.size(); k++)
                     if (!seen[var(c[k])] && level[var(c[k])] != 0){
                         out_learnt[j++] = out_learnt[i];
@@ -334,7 +391,7 @@ void Solver::analyze(Clause* confl, vec<Lit>& out_learnt, int& out_btlevel)
         for (int k = 0; k < analyze_toclear.size(); k++){
             Var     v = var(analyze_toclear[k]); assert(level[v] > 0);
 				Lit     l = analyze_toclear[k];
-            Clause& c = *reason[v];
+            Clause& c = ca[reason[v]];
             proof->resolve(c.id(), l);
             for (int k = 1; k < c.size(); k++)
                 if (level[var(c[k])] == 0)
@@ -357,17 +414,17 @@ void Solver::analyze(Clause* confl, vec<Lit>& out_learnt, int& out_btlevel)
 //
 bool Solver::analyze_removable(Lit p, uint min_level)
 {
-    assert(reason[var(p)] != NULL);
+    assert(reason[var(p)] != CRef_Undef);
     analyze_stack.clear(); analyze_stack.push(p);
     int top = analyze_toclear.size();
     while (analyze_stack.size() > 0){
-        assert(reason[var(analyze_stack.last())] != NULL);
-        Clause& c = *reason[var(analyze_stack.last())];
+        assert(reason[var(analyze_stack.last())] != CRef_Undef);
+        Clause& c = ca[reason[var(analyze_stack.last())]];
         analyze_stack.pop();
         for (int i = 1; i < c.size(); i++){
             Lit p = c[i];
             if (!analyze_seen[var(p)] && level[var(p)] != 0){
-                if (reason[var(p)] != NULL && ((1 << (level[var(p)] & 31)) & min_level) != 0){
+                if (reason[var(p)] != CRef_Undef && ((1 << (level[var(p)] & 31)) & min_level) != 0){
                     analyze_seen[var(p)] = 1;
                     analyze_stack.push(p);
                     analyze_toclear.push(p);
@@ -388,7 +445,7 @@ bool Solver::analyze_removable(Lit p, uint min_level)
 
 /*_________________________________________________________________________________________________
 |
-|  analyzeFinal : (confl : Clause*) (skip_first : bool)  ->  [void]
+|  analyzeFinal : (confl : CRef) (skip_first : bool)  ->  [void]
 |  
 |  Description:
 |    Specialized analysis procedure to express the final conflict in terms of assumptions.
@@ -396,7 +453,7 @@ bool Solver::analyze_removable(Lit p, uint min_level)
 |    making assumptions). If 'skip_first' is TRUE, the first literal of 'confl' is  ignored (needed
 |    if conflict arose before search even started).
 |________________________________________________________________________________________________@*/
-void Solver::analyzeFinal(Clause* confl, bool skip_first)
+void Solver::analyzeFinal(CRef cr, bool skip_first)
 {
     // -- NOTE! This code is relatively untested. Please report bugs!
     conflict.clear();
@@ -405,10 +462,11 @@ void Solver::analyzeFinal(Clause* confl, bool skip_first)
         return; }
    //assert(false);
     vec<char>&     seen  = analyze_seen;
-    if (proof != NULL) proof->beginChain(confl->id());
-    for (int i = skip_first ? 1 : 0; i < confl->size(); i++){
-        Var     x = var((*confl)[i]);
-		  Lit		 l = (*confl)[i];
+    const Clause&  confl = ca[cr];
+    if (proof != NULL) proof->beginChain(confl.id());
+    for (int i = skip_first ? 1 : 0; i < confl.size(); i++){
+        Var     x = var(confl[i]);
+		  Lit		 l = confl[i];
         if (level[x] > 0)
             seen[x] = 1;
         else
@@ -420,12 +478,12 @@ void Solver::analyzeFinal(Clause* confl, bool skip_first)
         Var     x = var(trail[i]);
 		  Lit     l = trail[i];
         if (seen[x]){
-            Clause* r = reason[x];
-            if (r == NULL){
+            CRef r = reason[x];
+            if (r == CRef_Undef){
                 assert(level[x] > 0);
                 conflict.push(~trail[i]);
             }else{
-                Clause& c = *r;
+                Clause& c = ca[r];
                 if (proof != NULL) proof->resolve(c.id(), l);
                 for (int j = 1; j < c.size(); j++)
                     if (level[var(c[j])] > 0)
@@ -442,7 +500,7 @@ void Solver::analyzeFinal(Clause* confl, bool skip_first)
 
 /*_________________________________________________________________________________________________
 |
-|  enqueue : (p : Lit) (from : Clause*)  ->  [bool]
+|  enqueue : (p : Lit) (from : CRef)  ->  [bool]
 |  
 |  Description:
 |    Puts a new fact on the propagation queue as well as immediately updating the variable's value.
@@ -451,12 +509,12 @@ void Solver::analyzeFinal(Clause* confl, bool skip_first)
 |  Input:
 |    p    - The fact to enqueue
 |    from - [Optional] Fact propagated from this (currently) unit clause. Stored in 'reason[]'.
-|           Default value is NULL (no reason).
+|           Default value is 'CRef_Undef' (no reason).
 |  
 |  Output:
 |    TRUE if fact was enqueued without conflict, FALSE otherwise.
 |________________________________________________________________________________________________@*/
-bool Solver::enqueue(Lit p, Clause* from)
+bool Solver::enqueue(Lit p, CRef from)
 {
     if (value(p) != l_Undef)
         return value(p) != l_False;
@@ -475,71 +533,92 @@ bool Solver::enqueue(Lit p, Clause* from)
 
 /*_________________________________________________________________________________________________
 |
-|  propagate : [void]  ->  [Clause*]
+|  propagate : [void]  ->  [CRef]
 |  
 |  Description:
 |    Propagates all enqueued facts. If a conflict arises, the conflicting clause is returned,
-|    otherwise NULL. NOTE! This method has been optimized for speed rather than readability.
+|    otherwise 'CRef_Undef'. NOTE! This method has been optimized for speed rather than readability.
+|    Binary clauses are handled first from 'bin_watches[]', where the implied literal is stored in
+|    the watcher itself. Longer clauses are only visited if their blocker literal is not true.
 |  
 |    Post-conditions:
 |      * The propagation queue is empty, even if there was a conflict.
 |________________________________________________________________________________________________@*/
-Clause* Solver::propagate()
+CRef Solver::propagate()
 {
-    Clause* confl = NULL;
+    CRef    confl = CRef_Undef;
     while (qhead < trail.size()){
         stats.propagations++;
         simpDB_props--;
 
         Lit            p  = trail[qhead++];     // 'p' is enqueued fact to propagate.
-        vec<Clause*>&  ws = watches[index(p)];
-        Clause**       i,** j,** end;
+        Lit            false_lit = ~p;
+
+        // Binary clauses:
+        vec<Watcher>&  bs = bin_watches[index(p)];
+        for (int k = 0; k < bs.size(); k++){
+            Lit   imp = bs[k].blocker;
+            lbool val = value(imp);
+            if (val == l_True) continue;
+
+            // Unit: make the implied literal data[0], as expected from a reason clause:
+            CRef    cr = bs[k].cref;
+            Clause& c  = ca[cr];
+            if (c[0] == false_lit)
+                c[0] = imp, c[1] = false_lit;
+            if (decisionLevel() == 0 && proof != NULL)
+                logUnit(c);
+
+            if (val == l_False){
+                if (decisionLevel() == 0)
+                    ok = false;
+                confl = cr;
+                qhead = trail.size();
+                break; }
+            check(enqueue(imp, cr));
+        }
+        if (confl != CRef_Undef) break;
+
+        // Longer clauses:
+        vec<Watcher>&  ws = watches[index(p)];
+        Watcher        *i, *j, *end;
 
-        for (i = j = (Clause**)ws, end = i + ws.size();  i != end;){
-            Clause& c = **i; i++;
+        for (i = j = (Watcher*)ws, end = i + ws.size();  i != end;){
+            // Try to avoid inspecting the clause:
+            if (value(i->blocker) == l_True){
+                *j++ = *i++; continue; }
+
+            CRef    cr = i->cref;
+            Clause& c  = ca[cr]; i++;
             // Make sure the false literal is data[1]:
-            Lit false_lit = ~p;
             if (c[0] == false_lit)
                 c[0] = c[1], c[1] = false_lit;
 
             assert(c[1] == false_lit);
 
             // If 0th watch is true, then clause is already satisfied.
-            Lit   first = c[0];
-            lbool val   = value(first);
+            Lit     first = c[0];
+            Watcher w(cr, first);
+            lbool   val   = value(first);
             if (val == l_True){
-                *j++ = &c;
+                *j++ = w;
             }else{
                 // Look for new watch:
                 for (int k = 2; k < c.size(); k++)
                     if (value(c[k]) != l_False){
                         c[1] = c[k]; c[k] = false_lit;
-                        watches[index(~c[1])].push(&c);
+                        watches[index(~c[1])].push(w);
                         goto FoundWatch; }
 
                 // Did not find watch -- clause is unit under assignment:
-                if (decisionLevel() == 0 && proof != NULL){
-                    // Log the production of this unit clause:
-                    proof->beginChain(c.id());
-                    for (int k = 1; k < c.size(); k++)
-                        proof->resolve(unit_id[var(c[k])], c[k]);
-                    ClauseId id = proof->endChain();
-                    assert(unit_id[var(first)] == ClauseId_NULL || value(first) == l_False);    // (if variable already has 'id', it must be with the other polarity and we should have derived the empty clause here)
-                    if (value(first) != l_False)
-                        unit_id[var(first)] = id;
-                    else{
-                        // Empty clause derived:
-                        proof->beginChain(unit_id[var(first)]);
-                        proof->resolve(id, ~first);
-                        proof->endChain();
-                    }
-                }
-					 
-                *j++ = &c;
-                if (!enqueue(first, &c)){
+                if (decisionLevel() == 0 && proof != NULL)
+                    logUnit(c);
+
+                *j++ = w;
+                if (!enqueue(first, cr)){
                     if (decisionLevel() == 0)
                         ok = false;
-                    confl = &c;
+                    confl = cr;
                     qhead = trail.size();
                     // Copy the remaining watches:
                     while (i < end)
@@ -555,6 +634,27 @@ Clause* Solver::propagate()
 }
 
 
+// Logs the production of the top-level unit clause 'c[0]' (all other literals of 'c' are false).
+//
+void Solver::logUnit(Clause& c)
+{
+    Lit first = c[0];
+    proof->beginChain(c.id());
+    for (int k = 1; k < c.size(); k++)
+        proof->resolve(unit_id[var(c[k])], c[k]);
+    ClauseId id = proof->endChain();
+    assert(unit_id[var(first)] == ClauseId_NULL || value(first) == l_False);    // (if variable already has 'id', it must be with the other polarity and we should have derived the empty clause here)
+    if (value(first) != l_False)
+        unit_id[var(first)] = id;
+    else{
+        // Empty clause derived:
+        proof->beginChain(unit_id[var(first)]);
+        proof->resolve(id, ~first);
+        proof->endChain();
+    }
+}
+
+
 /*_________________________________________________________________________________________________
 |
 |  reduceDB : ()  ->  [void]
@@ -562,27 +662,58 @@ Clause* Solver::propagate()
 |  Description:
 |    Remove half of the learnt clauses, minus the clauses locked by the current assignment. Locked
 |    clauses are clauses that are reason to some assignment. Binary clauses are never removed.
+|    With 'lbd_reduce', the half of highest LBD goes (ties broken by activity), so glue clauses
+|    (LBD <= 2) only go if they are more than half of the learnt clauses (protecting them always
+|    would leave the database over its limit and call 'reduceDB()' at every decision); otherwise
+|    the half of lowest activity goes, as well as any clause below an activity threshold.
 |________________________________________________________________________________________________@*/
-struct reduceDB_lt { bool operator () (Clause* x, Clause* y) { return x->size() > 2 && (y->size() == 2 || x->activity() < y->activity()); } };
+struct reduceDB_lt {
+    ClauseAllocator& ca;
+    reduceDB_lt(ClauseAllocator& ca_) : ca(ca_) {}
+    bool operator () (CRef x, CRef y) { return ca[x].size() > 2 && (ca[y].size() == 2 || ca[x].activity() < ca[y].activity()); } };
+struct reduceDB_lbd_lt {
+    ClauseAllocator& ca;
+    reduceDB_lbd_lt(ClauseAllocator& ca_) : ca(ca_) {}
+    bool operator () (CRef x, CRef y) {
+        if (ca[x].size() == 2) return false;
+        if (ca[y].size() == 2) return true;
+        if (ca[x].lbd() != ca[y].lbd()) return ca[x].lbd() > ca[y].lbd();
+        return ca[x].activity() < ca[y].activity(); }
+};
 void Solver::reduceDB()
 {
     int     i, j;
     double  extra_lim = cla_inc / learnts.size();    // Remove any clause below this activity
 
-    sort(learnts, reduceDB_lt());
+    if (lbd_reduce){
+        sort(learnts, reduceDB_lbd_lt(ca));
+        for (i = j = 0; i < learnts.size(); i++){
+            const Clause& c = ca[learnts[i]];
+            if (i < learnts.size() / 2 && c.size() > 2 && !locked(learnts[i]))
+                remove(learnts[i]);
+            else
+                learnts[j++] = learnts[i];
+        }
+        learnts.shrink(i - j);
+        checkGarbage();
+        return;
+    }
+
+    sort(learnts, reduceDB_lt(ca));
     for (i = j = 0; i < learnts.size() / 2; i++){
-        if (learnts[i]->size() > 2 && !locked(learnts[i]))
+        if (ca[learnts[i]].size() > 2 && !locked(learnts[i]))
             remove(learnts[i]);
         else
             learnts[j++] = learnts[i];
     }
     for (; i < learnts.size(); i++){
-        if (learnts[i]->size() > 2 && !locked(learnts[i]) && learnts[i]->activity() < extra_lim)
+        if (ca[learnts[i]].size() > 2 && !locked(learnts[i]) && ca[learnts[i]].activity() < extra_lim)
             remove(learnts[i]);
         else
             learnts[j++] = learnts[i];
     }
     learnts.shrink(i - j);
+    checkGarbage();
 }
 
 
@@ -599,7 +730,7 @@ void Solver::simplifyDB()
     if (!ok) return;    // GUARD (public method)
     assert(decisionLevel() == 0);
 
-    if (propagate() != NULL){
+    if (propagate() != CRef_Undef){
         ok = false;
         return; }
 
@@ -609,13 +740,15 @@ void Solver::simplifyDB()
     // Clear watcher lists:
     for (int i = simpDB_assigns; i < nAssigns(); i++){
         Lit p = trail[i];
-        watches[index( p)].clear(true);
-        watches[index(~p)].clear(true);
+        watches    [index( p)].clear(true);
+        watches    [index(~p)].clear(true);
+        bin_watches[index( p)].clear(true);
+        bin_watches[index(~p)].clear(true);
     }
 
     // Remove satisfied clauses:
     for (int type = 0; type < 2; type++){
-        vec<Clause*>& cs = type ? learnts : clauses;
+        vec<CRef>&    cs = type ? learnts : clauses;
         int           j  = 0;
         for (int i = 0; i < cs.size(); i++){
             if (!locked(cs[i]) && simplify(cs[i]))
@@ -625,12 +758,46 @@ void Solver::simplifyDB()
         }
         cs.shrink(cs.size()-j);
     }
+    checkGarbage();
 
     simpDB_assigns = nAssigns();
     simpDB_props   = stats.clauses_literals + stats.learnts_literals;   // (shouldn't depend on 'stats' really, but it will do for now)
 }
 
 
+// Compacts the clause memory if 'garbage_frac' of it is taken by removed clauses.
+//
+void Solver::checkGarbage()
+{
+    if (ca.wasted() > ca.size() * garbage_frac)
+        garbageCollect();
+}
+
+
+// Moves all live clauses into a new region without the removed ones, and updates every reference
+// to them (watchers, reasons, clause lists). The old region is released in one go.
+//
+void Solver::garbageCollect()
+{
+    ClauseAllocator to(ca.size() - ca.wasted());
+
+    for (int i = 0; i < watches.size(); i++){
+        vec<Watcher>& ws = watches[i];
+        for (int j = 0; j < ws.size(); j++) ca.reloc(ws[j].cref, to);
+        vec<Watcher>& bs = bin_watches[i];
+        for (int j = 0; j < bs.size(); j++) ca.reloc(bs[j].cref, to);
+    }
+    for (int i = 0; i < trail.size(); i++){
+        Var x = var(trail[i]);
+        if (reason[x] != CRef_Undef) ca.reloc(reason[x], to);
+    }
+    for (int i = 0; i < learnts.size(); i++) ca.reloc(learnts[i], to);
+    for (int i = 0; i < clauses.size(); i++) ca.reloc(clauses[i], to);
+
+    to.moveTo(ca);
+}
+
+
 /*_________________________________________________________________________________________________
 |
 |  search : (nof_conflicts : int) (nof_learnts : int) (params : const SearchParams&)  ->  [lbool]
@@ -638,7 +805,9 @@ void Solver::simplifyDB()
 |  Description:
 |    Search for a model the specified number of conflicts, keeping the number of learnt clauses
 |    below the provided limit. NOTE! Use negative value for 'nof_conflicts' or 'nof_learnts' to
-|    indicate infinity.
+|    indicate infinity. With glucose restarts, the search also stops when the last
+|    'lbd_queue_size' learnt clauses have a worse LBD than the average so far (times
+|    'params.restart_margin').
 |  
 |  Output:
 |    'l_True' if a partial assigment that is consistent with respect to the clauseset is found. If
@@ -654,11 +823,17 @@ lbool Solver::search(int nof_conflicts, int nof_learnts, const SearchParams& par
     int     conflictC = 0;
     var_decay = 1 / params.var_decay;
     cla_decay = 1 / params.clause_decay;
+    phase_saving = params.phase_saving;
+    lbd_reduce   = params.lbd_reduce;
+    bool    glucose_restart = false;
+    lbd_queue.clear();
+    lbd_queue_head = 0;
+    lbd_queue_sum  = 0;
     model.clear();
 
     for (;;){
-        Clause* confl = propagate();
-        if (confl != NULL){
+        CRef confl = propagate();
+        if (confl != CRef_Undef){
             // CONFLICT
 
             stats.conflicts++; conflictC++;
@@ -669,16 +844,33 @@ lbool Solver::search(int nof_conflicts, int nof_learnts, const SearchParams& par
                 analyzeFinal(confl);
                 return l_False; }
             analyze(confl, learnt_clause, backtrack_level);
+            int lbd = computeLBD(learnt_clause);
             cancelUntil(max(backtrack_level, root_level));
             newClause(learnt_clause, true, (proof != NULL) ? proof->last() : ClauseId_NULL);
             if (learnt_clause.size() == 1) level[var(learnt_clause[0])] = 0;    // (this is ugly (but needed for 'analyzeFinal()') -- in future versions, we will backtrack past the 'root_level' and redo the assumptions)
+            else ca[learnts.last()].lbd() = lbd;
+
+            lbd_sum += lbd;
+            if (params.restart == restart_Glucose){
+                if (lbd_queue.size() < lbd_queue_size)
+                    lbd_queue.push(lbd);
+                else{
+                    lbd_queue_sum -= lbd_queue[lbd_queue_head];
+                    lbd_queue[lbd_queue_head] = lbd;
+                    lbd_queue_head = (lbd_queue_head + 1) % lbd_queue_size; }
+                lbd_queue_sum += lbd;
+                if (lbd_queue.size() == lbd_queue_size
+                 && (double)lbd_queue_sum / lbd_queue_size * params.restart_margin > lbd_sum / stats.conflicts)
+                    glucose_restart = true;
+            }
             varDecayActivity();
             claDecayActivity();
 
         }else{
             // NO CONFLICT
 
-            if (nof_conflicts >= 0 && conflictC >= nof_conflicts){
+            if ((nof_conflicts >= 0 && conflictC >= nof_conflicts) || glucose_restart
+             || (conflict_stop >= 0 && stats.conflicts >= conflict_stop)){
                 // Reached bound on number of conflicts:
                 progress_estimate = progressEstimate();
                 cancelUntil(root_level);
@@ -704,7 +896,7 @@ lbool Solver::search(int nof_conflicts, int nof_learnts, const SearchParams& par
                 return l_True;
             }
 
-            check(assume(~Lit(next)));
+            check(assume(Lit(next, polarity[next])));
         }
     }
 }
@@ -738,33 +930,38 @@ void Solver::varRescaleActivity()
 void Solver::claRescaleActivity()
 {
     for (int i = 0; i < learnts.size(); i++)
-        learnts[i]->activity() *= 1e-20;
+        ca[learnts[i]].activity() *= 1e-20;
     cla_inc *= 1e-20;
 }
 
 
 /*_________________________________________________________________________________________________
 |
-|  solve : (assumps : const vec<Lit>&)  ->  [bool]
+|  solveLimited : (assumps : const vec<Lit>&)  ->  [lbool]
 |  
 |  Description:
 |    Top-level solve. If using assumptions (non-empty 'assumps' vector), you must call
 |    'simplifyDB()' first to see that no top-level conflict is present (which would put the solver
-|    in an undefined state).
+|    in an undefined state). Gives up with 'l_Undef' after 'conflict_budget' conflicts (if that
+|    is not negative); 'solve()' treats this as unsatisfiable. On 'l_False', 'conflict' holds the
+|    negated assumptions used, and is empty if the clauses are unsatisfiable on their own.
 |  
 |  Input:
 |    A list of assumptions (unit clauses coded as literals). Pre-condition: The assumptions must
 |    not contain both 'x' and '~x' for any variable 'x'.
 |________________________________________________________________________________________________@*/
-bool Solver::solve(const vec<Lit>& assumps)
+lbool Solver::solveLimited(const vec<Lit>& assumps)
 {
     simplifyDB();
-    if (!ok) return false;
+    if (!ok){
+        conflict.clear();
+        return l_False; }
 
     SearchParams    params(default_params);
-    double  nof_conflicts = 100;
+    double  nof_conflicts = params.restart_first;
     double  nof_learnts   = nClauses() / 3;
     lbool   status        = l_Undef;
+    int     restarts      = 0;
 
     // Perform assumptions:
     root_level = assumps.size();
@@ -772,7 +969,7 @@ bool Solver::solve(const vec<Lit>& assumps)
         Lit p = assumps[i];
         assert(var(p) < nVars());
         if (!assume(p)){
-            if (reason[var(p)] != NULL){
+            if (reason[var(p)] != CRef_Undef){
                 analyzeFinal(reason[var(p)], true);
                 conflict.push(~p);
             }else{
@@ -782,16 +979,17 @@ bool Solver::solve(const vec<Lit>& assumps)
                 if (proof != NULL) conflict_id = unit_id[var(p)];
             }
             cancelUntil(0);
-            return false; }
-        Clause* confl = propagate();
-        if (confl != NULL){
+            return l_False; }
+        CRef confl = propagate();
+        if (confl != CRef_Undef){
             analyzeFinal(confl), assert(conflict.size() > 0);
             cancelUntil(0);
-            return false; }
+            return l_False; }
     }
     assert(root_level == decisionLevel());
 
     // Search:
+    conflict_stop = conflict_budget < 0 ? -1 : stats.conflicts + conflict_budget;
     if (verbosity >= 1){
         reportf("==================================[MINISAT]");
         reportf("===================================\n");
@@ -815,14 +1013,15 @@ bool Solver::solve(const vec<Lit>& assumps)
                    progress_estimate*100);
             fflush(stdout);
         }
+        if (params.restart == restart_Luby)
+            nof_conflicts = params.restart_first * luby(restarts);
+        else if (params.restart == restart_Glucose)
+            nof_conflicts = -1;
         status = search((int)nof_conflicts, (int)nof_learnts, params);
-        nof_conflicts *= 1.5;
+        restarts++;
+        nof_conflicts *= params.restart_inc;
         nof_learnts   *= 1.1;
-
-if ((int)stats.conflicts >= effLimit) {
-   cancelUntil(0);
-   return status == l_True;
-}
+        if (conflict_stop >= 0 && stats.conflicts >= conflict_stop) break;
     }
     if (verbosity >= 1) {
         reportf("===========================================");
@@ -830,7 +1029,7 @@ if ((int)stats.conflicts >= effLimit) {
     }
 
     cancelUntil(0);
-    return status == l_True;
+    return status;
 }
 
 void Solver::printStats()
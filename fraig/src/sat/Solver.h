@@ -40,9 +40,23 @@ struct SolverStats {
 };
 
 
+enum RestartMode {
+    restart_Geometric,  // 'restart_first' conflicts, then 'restart_inc' times more after each restart (MiniSat 1.x).
+    restart_Luby,       // 'restart_first' times the Luby sequence 1,1,2,1,1,2,4,...
+    restart_Glucose     // Whenever the recent learnt clauses have a worse LBD than the average so far.
+};
+
 struct SearchParams {
     double  var_decay, clause_decay, random_var_freq;    // (reasonable values are: 0.95, 0.999, 0.02)    
-    SearchParams(double v = 1, double c = 1, double r = 0) : var_decay(v), clause_decay(c), random_var_freq(r) { }
+    RestartMode restart;            // Restart policy.
+    double  restart_first;          // Conflicts before the first restart (geometric), or the Luby unit.
+    double  restart_inc;            // Growth of the geometric restart interval.
+    double  restart_margin;         // Glucose: restart if recent average LBD * margin > average LBD.
+    bool    phase_saving;           // Branch on the value a variable had last instead of always on FALSE.
+    bool    lbd_reduce;             // Let 'reduceDB()' drop the learnt clauses of highest LBD rather than of lowest activity.
+    SearchParams(double v = 1, double c = 1, double r = 0) : var_decay(v), clause_decay(c), random_var_freq(r)
+        , restart(restart_Luby), restart_first(100), restart_inc(1.5), restart_margin(0.8)
+        , phase_saving(true), lbd_reduce(true) { }
 };
 
 
@@ -51,8 +65,9 @@ protected:
     // Solver state:
     //
     bool                ok;               // If FALSE, the constraints are already unsatisfiable. No part of the solver state may be used!
-    vec<Clause*>        clauses;          // List of problem clauses.
-    vec<Clause*>        learnts;          // List of learnt clauses.
+    ClauseAllocator     ca;               // Memory of all clauses; they are referred to by 'CRef's into it.
+    vec<CRef>           clauses;          // List of problem clauses.
+    vec<CRef>           learnts;          // List of learnt clauses.
     vec<ClauseId>       unit_id;          // 'unit_id[var]' is the clause ID for the unit literal 'var' or '~var' (if set at toplevel).
     double              cla_inc;          // Amount to bump next clause with.
     double              cla_decay;        // INVERSE decay factor for clause activity: stores 1/decay.
@@ -62,28 +77,37 @@ protected:
     double              var_decay;        // INVERSE decay factor for variable activity: stores 1/decay. Use negative value for static variable order.
     VarOrder            order;            // Keeps track of the decision variable order.
 
-    vec<vec<Clause*> >  watches;          // 'watches[lit]' is a list of constraints watching 'lit' (will go there if literal becomes true).
+    vec<vec<Watcher> >  watches;          // 'watches[lit]' is a list of constraints of size > 2 watching 'lit' (will go there if literal becomes true).
+    vec<vec<Watcher> >  bin_watches;      // 'bin_watches[lit]' is the same for binary clauses; the blocker is the implied literal.
     vec<char>           assigns;          // The current assignments (lbool:s stored as char:s).
     vec<Lit>            trail;            // Assignment stack; stores all assigments made in the order they were made.
     vec<int>            trail_lim;        // Separator indices for different decision levels in 'trail[]'.
-    vec<Clause*>        reason;           // 'reason[var]' is the clause that implied the variables current value, or 'NULL' if none.
+    vec<CRef>           reason;           // 'reason[var]' is the clause that implied the variables current value, or 'CRef_Undef' if none.
     vec<int>            level;            // 'level[var]' is the decision level at which assignment was made.
     vec<int>            trail_pos;        // 'trail_pos[var]' is the variable's position in 'trail[]'. This supersedes 'level[]' in some sense, and 'level[]' will probably be removed in future releases.
     int                 root_level;       // Level of first proper decision.
     int                 qhead;            // Head of queue (as index into the trail -- no more explicit propagation queue in MiniSat).
     int                 simpDB_assigns;   // Number of top-level assignments since last execution of 'simplifyDB()'.
     int64               simpDB_props;     // Remaining number of propagations that must be made before next execution of 'simplifyDB()'.
+    int64               conflict_stop;    // 'stats.conflicts' value at which the current 'solve()' gives up, or -1.
+    vec<char>           polarity;         // 'polarity[var]' is the sign of the literal to branch on (the last value of 'var' with phase saving).
+    bool                phase_saving;     // }- Copied from the 'SearchParams' of the current 'search()'.
+    bool                lbd_reduce;       // }
+    vec<int>            lbd_queue;        // LBDs of the last learnt clauses since the last restart (circular, for glucose restarts).
+    int                 lbd_queue_head;   // Next slot to overwrite in 'lbd_queue'.
+    int64               lbd_queue_sum;    // Sum of the LBDs in 'lbd_queue'.
+    double              lbd_sum;          // Sum of the LBDs of all learnt clauses.
 
     // Temporaries (to reduce allocation overhead). Each variable is prefixed by the method in which is used:
     //
     vec<char>           analyze_seen;
     vec<Lit>            analyze_stack;
     vec<Lit>            analyze_toclear;
-    Clause*             propagate_tmpbin;
-    Clause*             analyze_tmpbin;
     vec<Lit>            addUnit_tmp;
     vec<Lit>            addBinary_tmp;
     vec<Lit>            addTernary_tmp;
+    vec<uint>           lbd_seen;         // 'lbd_seen[level]' is 'lbd_stamp' if 'level' was counted by the current 'computeLBD()'.
+    uint                lbd_stamp;
 
     // Main internal methods:
     //
@@ -91,14 +115,17 @@ protected:
     void        cancelUntil      (int level);
     void        record           (const vec<Lit>& clause);
 
-    void        analyze          (Clause* confl, vec<Lit>& out_learnt, int& out_btlevel); // (bt = backtrack)
+    void        analyze          (CRef confl, vec<Lit>& out_learnt, int& out_btlevel);    // (bt = backtrack)
     bool        analyze_removable(Lit p, uint min_level);                                 // (helper method for 'analyze()')
-    void        analyzeFinal     (Clause* confl, bool skip_first = false);
-    bool        enqueue          (Lit fact, Clause* from = NULL);
-    Clause*     propagate        ();
+    void        analyzeFinal     (CRef confl, bool skip_first = false);
+    bool        enqueue          (Lit fact, CRef from = CRef_Undef);
+    CRef        propagate        ();
+    void        logUnit          (Clause& c);                                             // (helper method for 'propagate()')
     void        reduceDB         ();
     Lit         pickBranchLit    (const SearchParams& params);
     lbool       search           (int nof_conflicts, int nof_learnts, const SearchParams& params);
+    template<class C>
+    int         computeLBD       (const C& c);                                            // Number of distinct decision levels in 'c'.
     double      progressEstimate ();
 
     // Activity:
@@ -115,10 +142,14 @@ protected:
     // Operations on clauses:
     //
     void     newClause(const vec<Lit>& ps, bool learnt = false, ClauseId id = ClauseId_NULL, bool A = true);
-    void     claBumpActivity (Clause* c) { if ( (c->activity() += cla_inc) > 1e20 ) claRescaleActivity(); }
-    void     remove          (Clause* c, bool just_dealloc = false);
-    bool     locked          (const Clause* c) const { return reason[var((*c)[0])] == c; }
-    bool     simplify        (Clause* c) const;
+    void     claBumpActivity (Clause& c) { if ( (c.activity() += cla_inc) > 1e20 ) claRescaleActivity(); }
+    void     remove          (CRef cr);
+    void     attachClause    (CRef cr);
+    vec<Watcher>& watchList  (CRef cr, int i) { const Clause& c = ca[cr]; return (c.size() == 2 ? bin_watches : watches)[index(~c[i])]; }
+    bool     locked          (CRef cr) const { return reason[var(ca[cr][0])] == cr; }
+    bool     simplify        (CRef cr) const;
+    void     checkGarbage    ();                                                          // Compact 'ca' if enough of it is freed clauses.
+    void     garbageCollect  ();
 
     int      decisionLevel() const { return trail_lim.size(); }
 
@@ -132,27 +163,28 @@ public:
              , qhead            (0)
              , simpDB_assigns   (0)
              , simpDB_props     (0)
+             , conflict_stop    (-1)
+             , phase_saving     (false)
+             , lbd_reduce       (false)
+             , lbd_queue_head   (0)
+             , lbd_queue_sum    (0)
+             , lbd_sum          (0)
+             , lbd_stamp        (0)
              , default_params   (SearchParams(0.95, 0.999, 0.02))
              , expensive_ccmin  (2)
              , proof            (NULL)
              , verbosity        (0)
+             , conflict_budget  (-1)
              , progress_estimate(0)
              , conflict_id      (ClauseId_NULL)
              {
-                vec<Lit> dummy(2,lit_Undef);
-                propagate_tmpbin = Clause_new(false, dummy);
-                analyze_tmpbin   = Clause_new(false, dummy);
                 addUnit_tmp   .growTo(1);
                 addBinary_tmp .growTo(2);
                 addTernary_tmp.growTo(3);
+                lbd_seen.push(0);   // (level 0)
              }
 
-   ~Solver() {
-       for (int i = 0; i < learnts.size(); i++) remove(learnts[i], true);
-       for (int i = 0; i < clauses.size(); i++) if (clauses[i] != NULL) remove(clauses[i], true);
-       remove(propagate_tmpbin, true);
-       remove(analyze_tmpbin, true);
-    }
+   ~Solver() { }   // (the clauses go with 'ca')
 
     // Helpers: (semi-internal)
     //
@@ -175,6 +207,7 @@ public:
     int             expensive_ccmin;    // Controls conflict clause minimization. TRUE by default.
     Proof*          proof;              // Set this directly after constructing 'Solver' to enable proof logging. Initialized to NULL.
     int             verbosity;          // Verbosity level. 0=silent, 1=some progress report, 2=everything
+    int64           conflict_budget;    // Conflicts allowed per call to 'solve()'; -1 means no limit.
 
     // Problem specification:
     //
@@ -190,7 +223,8 @@ public:
     //
     bool    okay() { return ok; }       // FALSE means solver is in an conflicting state (must never be used again!)
     void    simplifyDB();
-    bool    solve(const vec<Lit>& assumps);
+    lbool   solveLimited(const vec<Lit>& assumps);  // 'l_Undef' if 'conflict_budget' ran out
+    bool    solve(const vec<Lit>& assumps) { return solveLimited(assumps) == l_True; }
     bool    solve() { vec<Lit> tmp; return solve(tmp); }
 
     double      progress_estimate;  // Set by 'search()'.
@@ -82,59 +82,116 @@ const   int ClauseId_NULL = INT_MIN;
 //- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
 class Clause {
-    uint    size_learnt;
+    uint    header;     // size << 3 | reloced << 2 | has_id << 1 | learnt
     Lit     data[1];
 public:
     // NOTE: This constructor cannot be used directly (doesn't allocate enough memory).
     Clause(bool learnt, const vec<Lit>& ps, ClauseId id_ = ClauseId_NULL) {
-        size_learnt = (ps.size() << 1) | (int)learnt;
+        header = (ps.size() << 3) | ((int)(id_ != ClauseId_NULL) << 1) | (int)learnt;
         for (int i = 0; i < ps.size(); i++) data[i] = ps[i];
-        if (learnt) activity() = 0;
+        if (learnt) activity() = 0, lbd() = ps.size();
         if (id_ != ClauseId_NULL) id() = id_; }
 
-    // -- use this function instead:
-    friend Clause* Clause_new(bool, const vec<Lit>&, ClauseId);
+    // -- use 'ClauseAllocator::alloc()' instead.
 
-    int       size        ()      const { return size_learnt >> 1; }
-    bool      learnt      ()      const { return size_learnt & 1; }
+    int       size        ()      const { return header >> 3; }
+    bool      learnt      ()      const { return header & 1; }
+    bool      hasId       ()      const { return header & 2; }
+    int       words       ()      const { return 1 + size() + 2*(int)learnt() + (int)hasId(); }   // Memory taken, in 32-bit words.
     Lit       operator [] (int i) const { return data[i]; }
     Lit&      operator [] (int i)       { return data[i]; }
     float&    activity    ()      const {
         void *p = const_cast<Lit*>(&data[size()]); return *((float *)p);
     } //              return *((float*)&data[size()]); }
-    ClauseId& id          ()      const { return *((ClauseId*)&data[size() + (int)learnt()]); }
-};
+    uint&     lbd         ()      const { return *((uint*)&data[size() + 1]); }    // (learnt clauses only)
+    ClauseId& id          ()      const { return *((ClauseId*)&data[size() + 2*(int)learnt()]); }
 
-inline Clause* Clause_new(bool learnt, const vec<Lit>& ps, ClauseId id = ClauseId_NULL) {
-    assert(sizeof(Lit)      == sizeof(uint));
-    assert(sizeof(float)    == sizeof(uint));
-    assert(sizeof(ClauseId) == sizeof(uint));
-    void*   mem = xmalloc<char>(sizeof(Clause) + sizeof(uint)*(ps.size() + (int)learnt + (int)(id != ClauseId_NULL)));
-    return new (mem) Clause(learnt, ps, id); }
+    // Garbage collection: a moved clause keeps its new reference in place of its first literal.
+    bool      reloced     ()      const { return header & 4; }
+    uint      relocation  ()      const { return *((uint*)&data[0]); }
+    void      relocate    (uint cr)     { header |= 4; *((uint*)&data[0]) = cr; }
+};
 
 
 //=================================================================================================
-// GClause -- Generalize clause:
-
+// ClauseAllocator -- one region of memory holding all the clauses of a solver:
+
+
+// Clauses are referred to by their offset in the region (in 32-bit words), so a reference only
+// takes 32 bits and stays valid when the region grows. Freed clauses are not reused; their space
+// is counted in 'wasted()' until 'reloc()'-ing all live clauses into a new allocator compacts it.
+//
+typedef uint CRef;
+const   CRef CRef_Undef = UINT_MAX;
+
+class ClauseAllocator {
+    uint*   memory;
+    uint    sz;
+    uint    cap;
+    uint    wasted_;
+
+    CRef allocWords(int n) {
+        assert(n > 0 && (uint64)sz + n < CRef_Undef);
+        if (sz + n > cap){
+            while (sz + n > cap){
+                uint delta = ((cap >> 1) + (cap >> 3) + 2) & ~1;     // (grow by about 5/8)
+                cap = (cap + delta < cap) ? CRef_Undef - 1 : cap + delta; }
+            memory = xrealloc(memory, cap); }
+        CRef cr = sz;
+        sz += n;
+        return cr; }
 
-// Either a pointer to a clause or a literal.
-class GClause {
-    void*   data;
-    GClause(void* d) : data(d) {}
 public:
-    friend GClause GClause_new(Lit p);
-    friend GClause GClause_new(Clause* c);
-
-    bool        isLit    () const { return ((uintp)data & 1) == 1; }
-    Lit         lit      () const { return toLit(((intp)data) >> 1); }
-    Clause*     clause   () const { return (Clause*)data; }
-    bool        operator == (GClause c) const { return data == c.data; }
-    bool        operator != (GClause c) const { return data != c.data; }
+    ClauseAllocator(uint start_cap = 0) : memory(NULL), sz(0), cap(0), wasted_(0) {
+        if (start_cap > 0) memory = xmalloc<uint>(start_cap), cap = start_cap; }
+   ~ClauseAllocator() { xfree(memory); }
+
+    CRef alloc(const vec<Lit>& ps, bool learnt, ClauseId id = ClauseId_NULL) {
+        assert(sizeof(Lit)      == sizeof(uint));
+        assert(sizeof(float)    == sizeof(uint));
+        assert(sizeof(ClauseId) == sizeof(uint));
+        CRef cr = allocWords(1 + ps.size() + 2*(int)learnt + (int)(id != ClauseId_NULL));
+        new (&memory[cr]) Clause(learnt, ps, id);
+        return cr; }
+    void free(CRef cr) { wasted_ += (*this)[cr].words(); }
+
+    Clause&       operator [] (CRef cr)       { return *(Clause*)&memory[cr]; }
+    const Clause& operator [] (CRef cr) const { return *(const Clause*)&memory[cr]; }
+
+    uint size  () const { return sz; }
+    uint wasted() const { return wasted_; }
+
+    // Copy the clause 'cr' into 'to' (once) and update 'cr' to its new reference.
+    void reloc(CRef& cr, ClauseAllocator& to) {
+        Clause& c = (*this)[cr];
+        if (c.reloced()){ cr = c.relocation(); return; }
+        CRef nr = to.allocWords(c.words());
+        memcpy(&to.memory[nr], &c, sizeof(uint) * c.words());
+        c.relocate(nr);
+        cr = nr; }
+
+    // Hand over the region to 'to' (whose own region is released); this allocator becomes empty.
+    void moveTo(ClauseAllocator& to) {
+        xfree(to.memory);
+        to.memory = memory; to.sz = sz; to.cap = cap; to.wasted_ = wasted_;
+        memory = NULL; sz = cap = wasted_ = 0; }
 };
-inline GClause GClause_new(Lit p)     { return GClause((void*)(((intp)index(p) << 1) + 1)); }
-inline GClause GClause_new(Clause* c) { assert(((uintp)c & 1) == 0); return GClause((void*)c); }
 
-#define GClause_NULL GClause_new((Clause*)NULL)
+
+//=================================================================================================
+// Watcher -- an entry of a watcher list:
+
+
+// The clause together with a "blocker", one of its other literals. If the blocker is true, the
+// clause is satisfied and 'propagate()' can skip it without touching the clause memory. For a
+// binary clause the blocker is the other literal, so the clause itself is only read when it
+// becomes unit or conflicting.
+struct Watcher {
+    CRef    cref;
+    Lit     blocker;
+    Watcher() : cref(CRef_Undef), blocker(lit_Undef) {}
+    Watcher(CRef cr, Lit p) : cref(cr), blocker(p) {}
+};
 
 
 //=================================================================================================
@@ -15,12 +15,20 @@
 
 using namespace std;
 
+// Result of a resource-limited solve
+enum SatResult
+{
+   SAT_UNSAT     = 0,
+   SAT_SAT       = 1,
+   SAT_UNDECIDED = 2
+};
+
 /********** MiniSAT_Solver **********/
 class SatSolver
 {
    public : 
       SatSolver():_solver(0) { }
-      ~SatSolver() { }
+      ~SatSolver() { if (_solver) delete _solver; }
 
       // Solver initialization and reset
       void initialize() {
@@ -65,12 +73,59 @@ class SatSolver
          _solver->addClause(lits); lits.clear();
       }
 
+      // Miter "a != b" guarded by the fresh Var "act": it only holds while
+      // "act" is assumed true (fa/fb = true if inverted)
+      void addMiterCNF(Var act, Var va, bool fa, Var vb, bool fb) {
+         vec<Lit> lits;
+         Lit la = fa? ~Lit(va): Lit(va);
+         Lit lb = fb? ~Lit(vb): Lit(vb);
+         lits.push(~Lit(act)); lits.push( la); lits.push( lb);
+         _solver->addClause(lits); lits.clear();
+         lits.push(~Lit(act)); lits.push(~la); lits.push(~lb);
+         _solver->addClause(lits); lits.clear();
+      }
+      // "a == b" (fa/fb = true if inverted)
+      void addEqCNF(Var va, bool fa, Var vb, bool fb) {
+         Lit la = fa? ~Lit(va): Lit(va);
+         Lit lb = fb? ~Lit(vb): Lit(vb);
+         _solver->addBinary(~la, lb);
+         _solver->addBinary( la, ~lb);
+      }
+      // Turn "act" off for good. The clauses it guards are then satisfied
+      // and get removed (with their watchers) by a later simplifyDB(). Every
+      // solve calls it, but it only cleans up once the solver has made about
+      // as many propagations as its clauses hold literals since the last
+      // time, so retired miters go in batches rather than after each query.
+      void retireActivation(Var act) { _solver->addUnit(~Lit(act)); }
+
       // For incremental proof, use "assumeSolve()"
       void assumeRelease() { _assump.clear(); }
       void assumeProperty(Var prop, bool val) {
          _assump.push(val? Lit(prop): ~Lit(prop));
       }
       bool assumpSolve() { return _solver->solve(_assump); }
+      // Give up after "maxConfl" conflicts; a negative value means no limit
+      SatResult assumpSolve(int64 maxConfl) {
+         _solver->conflict_budget = maxConfl;
+         lbool res = _solver->solveLimited(_assump);
+         _solver->conflict_budget = -1;
+         return res == l_True? SAT_SAT: (res == l_False? SAT_UNSAT: SAT_UNDECIDED);
+      }
+
+      // After "assumpSolve()" returns UNSAT: the assumptions it was derived from,
+      // a subset of those given by "assumeProperty()" (empty if UNSAT without any)
+      void getAssumpCore(vec<Lit>& core) const {
+         const vec<Lit>& confl = _solver->conflict;   // (negated assumptions)
+         core.clear();
+         for (int i = 0; i < confl.size(); ++i) core.push(~confl[i]);
+      }
+      bool inAssumpCore(Var prop, bool val) const {
+         const vec<Lit>& confl = _solver->conflict;
+         Lit p = val? ~Lit(prop): Lit(prop);
+         for (int i = 0; i < confl.size(); ++i)
+            if (confl[i] == p) return true;
+         return false;
+      }
 
       // For one time proof, use "solve"
       void assertProperty(Var prop, bool val) {
@@ -87,6 +87,24 @@ void reportResult(const SatSolver& solver, bool result)
    }
 }
 
+// After an UNSAT "assumpSolve()": the core must only use the given
+// assumptions, and assuming the core alone must be UNSAT again
+bool checkCore(SatSolver& solver, const vector<Lit>& assumps)
+{
+   vec<Lit> core;
+   solver.getAssumpCore(core);
+   for (int i = 0; i < core.size(); ++i) {
+      size_t j = 0;
+      while (j < assumps.size() && !(assumps[j] == core[i])) ++j;
+      if (j == assumps.size()) return false;
+      if (!solver.inAssumpCore(var(core[i]), !sign(core[i]))) return false;
+   }
+   solver.assumeRelease();
+   for (int i = 0; i < core.size(); ++i)
+      solver.assumeProperty(var(core[i]), !sign(core[i]));
+   return !solver.assumpSolve();
+}
+
 int main()
 {
    initCircuit();
@@ -115,4 +133,40 @@ int main()
    solver.assumeProperty(newV, true);  // k = 1
    result = solver.assumpSolve();
    reportResult(solver, result);
+
+   cout << endl << endl << "======================" << endl;
+
+   // Solve(Gate(6) & Gate(1) & Gate(2) & !Gate(3)): Gate(3) is not needed
+   vector<Lit> assumps;
+   assumps.push_back(Lit(gates[5]->getVar()));
+   assumps.push_back(Lit(gates[0]->getVar()));
+   assumps.push_back(Lit(gates[1]->getVar()));
+   assumps.push_back(~Lit(gates[3]->getVar()));
+   solver.assumeRelease();  // Clear assumptions
+   for (size_t i = 0, n = assumps.size(); i < n; ++i)
+      solver.assumeProperty(var(assumps[i]), !sign(assumps[i]));
+   result = solver.assumpSolve();
+   reportResult(solver, result);
+   bool coreOk = !result && !solver.inAssumpCore(gates[3]->getVar(), false)
+                 && checkCore(solver, assumps);
+   cout << "Core " << (coreOk? "OK" : "FAILED") << endl;
+
+   cout << endl << endl << "======================" << endl;
+
+   // Gate(1) & !Gate(1) makes the clauses UNSAT on their own, so "solve"
+   // stops before any assumption and the core must be empty
+   solver.assertProperty(gates[0]->getVar(), true);
+   solver.assertProperty(gates[0]->getVar(), false);
+   assumps.clear();
+   assumps.push_back(~Lit(gates[3]->getVar()));
+   solver.assumeRelease();  // Clear assumptions
+   solver.assumeProperty(gates[3]->getVar(), false);
+   result = solver.assumpSolve();
+   reportResult(solver, result);
+   vec<Lit> core;
+   solver.getAssumpCore(core);
+   bool emptyOk = !result && core.size() == 0 && checkCore(solver, assumps);
+   cout << "Core " << (emptyOk? "OK" : "FAILED") << endl;
+
+   return (coreOk && emptyOk)? 0 : 1;
 }
@@ -10,6 +10,7 @@
 #define MY_HASH_MAP_H
 
 #include <vector>
+#include <cstddef>
 
 using namespace std;
 